@@ -0,0 +1,23 @@
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// No argv yet: print the file the kernel shell can't easily show in bulk.
+#define CAT_PATH "/hello.txt"
+
+int main(void) {
+    int fd = open(CAT_PATH, O_RDONLY);
+    if (fd < 0) {
+        printf("cat: can't open %s\n", CAT_PATH);
+        return 1;
+    }
+
+    // big reads straight into our buffer, one write per chunk
+    static char buf[4096];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) {
+        write(STDOUT_FILENO, buf, (size_t)n);
+    }
+    close(fd);
+    return 0;
+}
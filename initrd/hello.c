@@ -1,30 +1,22 @@
-#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
-static inline void sys_exit(int code) {
-    asm volatile(
-        "movl $2, %%eax\n"   // SYS_exit = 2
-        "movl %0, %%ebx\n"
-        "int $0x80\n"
-        :
-        : "r"(code)
-        : "eax", "ebx"
-    );
-    __builtin_unreachable();
-}
+int main(void) {
+    printf("hello from userland!\n");
 
-void _start(void) {
-    const char* s = "hello from userland!\n";
-    while (*s) {
-        // your sys_putchar
-        uint32_t v = (uint32_t)*s++;
-        asm volatile(
-            "movl $1, %%eax\n"
-            "movl %0, %%ebx\n"
-            "int $0x80\n"
-            :
-            : "r"(v)
-            : "eax","ebx"
-        );
+    // heap comes from brk, big blocks from mmap
+    char* small = malloc(64);
+    char* big = malloc(256 * 1024);
+    if (!small || !big) {
+        printf("malloc failed\n");
+        return 1;
     }
-    sys_exit(0);
+    strcpy(small, "malloc works");
+    memset(big, 'x', 256 * 1024);
+    printf("%s, big[last]=%c\n", small, big[256 * 1024 - 1]);
+
+    free(big);
+    free(small);
+    return 0;
 }
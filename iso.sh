@@ -7,6 +7,15 @@ mkdir -p isodir/boot
 mkdir -p isodir/boot/grub
 
 cp sysroot/boot/myos.kernel isodir/boot/myos.kernel
+
+# user programs: initrd/<name>.c -> initrd/<name>, linked against the libc
+# and crt0 that build.sh just installed into the sysroot
+USER_PROGRAMS="hello cat"
+for PROG in $USER_PROGRAMS; do
+  $CC -O2 -ffreestanding -nostdlib -T initrd/hello.ld -L"$SYSROOT$LIBDIR" \
+    -o initrd/$PROG "$SYSROOT$LIBDIR/crt0.o" initrd/$PROG.c -lc -lgcc
+done
+
 tar -C initrd -cf isodir/boot/initrd.tar .
 cat > isodir/boot/grub/grub.cfg << EOF
 menuentry "bobliu (shell)" {
@@ -3,11 +3,6 @@
 #include <arch/i386/portio.h>
 #include <stdio.h>
 
-volatile uint32_t g_user_exited = 0;
-volatile uint32_t g_exec_kesp = 0;
-volatile uint32_t g_exec_resume_eip = 0;
-volatile uint32_t g_exec_kcr3 = 0;
-
 volatile uint32_t dbg_iret_eip    = 0;
 volatile uint32_t dbg_iret_cs     = 0;
 volatile uint32_t dbg_iret_eflags = 0;
@@ -17,25 +12,6 @@ volatile uint32_t dbg_iret_ss     = 0;
 // asm file instead
 extern void enter_user(uint32_t entry, uint32_t user_stack_top) __attribute__((noreturn));
 
-static inline uint32_t read_esp(void) {
-    uint32_t v;
-    asm volatile("mov %%esp, %0" : "=r"(v));
-    return v;
-}
-
-void exec_mark_kernel_stack(void) {
-    g_exec_kesp = read_esp();
-}
-
-/*
-__attribute__((noinline))
-int exec_enter_usermode(uint32_t entry, uint32_t user_stack_top) {
-    (void)entry; (void)user_stack_top;
-    // Should never be reached
-    for (;;) asm volatile("hlt");
-}
-*/
-
 static inline uint32_t read_eflags(void) {
     uint32_t e;
     __asm__ volatile("pushfl; popl %0" : "=r"(e));
@@ -0,0 +1,138 @@
+// fpu.c
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <arch/i386/cpu.h>
+#include <arch/i386/smp.h>
+#include <arch/i386/thread.h>
+#include <arch/i386/fpu.h>
+
+#define CR0_MP (1u << 1)
+#define CR0_EM (1u << 2)
+#define CR0_TS (1u << 3)
+#define CR0_NE (1u << 5)
+#define CR4_OSFXSR     (1u << 9)
+#define CR4_OSXMMEXCPT (1u << 10)
+
+#define FPU_NO_CPU 0xFFFFFFFFu
+
+// Per CPU, only touched by that CPU with IRQs off. 'owner' is the thread
+// whose state the registers hold (0 = nobody's); 'live' means TS is clear
+// and the owner may have changed them since they were last saved.
+typedef struct {
+    struct thread* owner;
+    int live;
+} fpu_cpu_t;
+
+static fpu_cpu_t g_fpu[CPU_MAX];
+static int g_fpu_on = 0;
+static int g_sse = 0;
+// fninit state with the default MXCSR; new threads start from this
+static uint8_t g_fpu_clean[FPU_STATE_SIZE] __attribute__((aligned(16)));
+
+static inline uint32_t read_cr0(void) {
+    uint32_t v;
+    __asm__ volatile ("mov %%cr0, %0" : "=r"(v));
+    return v;
+}
+static inline void write_cr0(uint32_t v) {
+    __asm__ volatile ("mov %0, %%cr0" :: "r"(v) : "memory");
+}
+static inline uint32_t read_cr4(void) {
+    uint32_t v;
+    __asm__ volatile ("mov %%cr4, %0" : "=r"(v));
+    return v;
+}
+static inline void write_cr4(uint32_t v) {
+    __asm__ volatile ("mov %0, %%cr4" :: "r"(v) : "memory");
+}
+
+static inline void clts(void) {
+    __asm__ volatile ("clts" ::: "memory");
+}
+static inline void stts(void) {
+    write_cr0(read_cr0() | CR0_TS);
+}
+static inline void fxsave(uint8_t* area) {
+    __asm__ volatile ("fxsave (%0)" :: "r"(area) : "memory");
+}
+static inline void fxrstor(const uint8_t* area) {
+    __asm__ volatile ("fxrstor (%0)" :: "r"(area) : "memory");
+}
+
+static void cpu_setup(void) {
+    uint32_t cr0 = read_cr0();
+    cr0 &= ~CR0_EM;
+    cr0 |= CR0_MP | CR0_NE;
+    write_cr0(cr0);
+
+    uint32_t cr4 = read_cr4() | CR4_OSFXSR;
+    if (g_sse) cr4 |= CR4_OSXMMEXCPT;
+    write_cr4(cr4);
+
+    __asm__ volatile ("fninit");
+    stts();
+}
+
+void fpu_init(void) {
+    uint32_t d = cpuid_edx(1);
+    if (!(d & CPUID_EDX_FPU) || !(d & CPUID_EDX_FXSR)) {
+        printf("fpu: no FXSAVE, FPU/SSE left off\n");
+        return;
+    }
+    g_sse = (d & CPUID_EDX_SSE) ? 1 : 0;
+
+    uint32_t f = irq_save();
+    cpu_setup();
+    clts();
+    fxsave(g_fpu_clean);        // right after fninit: the clean state
+    stts();
+    g_fpu_on = 1;
+    irq_restore(f);
+
+    printf("fpu: x87%s, lazy switching\n", g_sse ? " + SSE" : "");
+}
+
+void fpu_init_cpu(void) {
+    if (g_fpu_on) cpu_setup();
+}
+
+int fpu_enabled(void) {
+    return g_fpu_on;
+}
+
+void fpu_thread_init(thread_t* t) {
+    t->fpu_used = 0;
+    t->fpu_cpu = FPU_NO_CPU;
+}
+
+void fpu_switch_out(thread_t* prev) {
+    if (!g_fpu_on) return;
+    fpu_cpu_t* c = &g_fpu[cpu_id()];
+    if (c->live) {
+        // still the owner: the registers match what we save here
+        fxsave(prev->fpu_state);
+        c->live = 0;
+    }
+    stts();
+}
+
+int fpu_trap(void) {
+    if (!g_fpu_on) return 0;
+    uint32_t f = irq_save();
+    uint32_t me = cpu_id();
+    fpu_cpu_t* c = &g_fpu[me];
+    thread_t* t = thread_current();
+
+    clts();
+    // the registers are still ours unless we ran somewhere else since
+    if (c->owner != t || t->fpu_cpu != me) {
+        fxrstor(t->fpu_used ? t->fpu_state : g_fpu_clean);
+        t->fpu_used = 1;
+        t->fpu_cpu = me;
+        c->owner = t;
+    }
+    c->live = 1;
+    irq_restore(f);
+    return 1;
+}
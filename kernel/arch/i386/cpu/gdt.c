@@ -1,6 +1,7 @@
 // gdt.c
 #include <stdint.h>
 #include <arch/i386/gdt.h>
+#include <arch/i386/smp.h>
 
 struct __attribute__((packed)) gdt_entry {
     uint16_t limit_low;
@@ -16,12 +17,15 @@ struct __attribute__((packed)) gdt_ptr {
     uint32_t base;
 };
 
-static struct gdt_entry gdt[6];
-static struct gdt_ptr gp;
+// 5 fixed entries, then one TSS slot per CPU (only a CPU's own slot is filled
+// in its table, but the selectors line up everywhere)
+static struct gdt_entry g_gdt[CPU_MAX][5 + CPU_MAX];
+static struct gdt_ptr g_gp[CPU_MAX];
 
 extern void gdt_flush(uint32_t gp_addr);
 
-static void gdt_set(int i, uint32_t base, uint32_t limit, uint8_t access, uint8_t gran) {
+static void gdt_set(uint32_t cpu, int i, uint32_t base, uint32_t limit, uint8_t access, uint8_t gran) {
+    struct gdt_entry* gdt = g_gdt[cpu];
     gdt[i].base_low  = base & 0xFFFF;
     gdt[i].base_mid  = (base >> 16) & 0xFF;
     gdt[i].base_high = (base >> 24) & 0xFF;
@@ -37,26 +41,31 @@ static void dump_gdt_entry5(void) {
     extern uint8_t gdt_raw[]; // not available unless you expose it
 }
 
-void gdt_set_tss(uint32_t base, uint32_t limit, uint8_t access, uint8_t gran) {
-    // put TSS at index 5
-    gdt_set(5, base, limit, access, gran);
+void gdt_set_tss(uint32_t cpu, uint32_t base, uint32_t limit, uint8_t access, uint8_t gran) {
+    // CPU n's TSS at index 5+n, see GDT_TSS_SEL
+    gdt_set(cpu, 5 + (int)cpu, base, limit, access, gran);
 }
 
-void gdt_init(void) {
-    gp.limit = sizeof(gdt) - 1;
-    gp.base  = (uint32_t)&gdt[0];
+void gdt_init_cpu(uint32_t cpu) {
+    struct gdt_ptr* gp = &g_gp[cpu];
+    gp->limit = sizeof(g_gdt[cpu]) - 1;
+    gp->base  = (uint32_t)&g_gdt[cpu][0];
 
-    gdt_set(0, 0, 0, 0, 0);
+    gdt_set(cpu, 0, 0, 0, 0, 0);
 
     // kernel code/data
-    gdt_set(1, 0, 0xFFFFFFFF, 0x9A, 0xCF); // 0x08
-    gdt_set(2, 0, 0xFFFFFFFF, 0x92, 0xCF); // 0x10
+    gdt_set(cpu, 1, 0, 0xFFFFFFFF, 0x9A, 0xCF); // 0x08
+    gdt_set(cpu, 2, 0, 0xFFFFFFFF, 0x92, 0xCF); // 0x10
 
     // user code/data
-    gdt_set(3, 0, 0xFFFFFFFF, 0xFA, 0xCF); // 0x18 (use as 0x1B in ring3)
-    gdt_set(4, 0, 0xFFFFFFFF, 0xF2, 0xCF); // 0x20 (use as 0x23 in ring3)
+    gdt_set(cpu, 3, 0, 0xFFFFFFFF, 0xFA, 0xCF); // 0x18 (use as 0x1B in ring3)
+    gdt_set(cpu, 4, 0, 0xFFFFFFFF, 0xF2, 0xCF); // 0x20 (use as 0x23 in ring3)
+
+    // index 5+cpu reserved for TSS; filled by tss_init_cpu()
 
-    // index 5 reserved for TSS; filled by tss_init()
+    gdt_flush((uint32_t)gp);
+}
 
-    gdt_flush((uint32_t)&gp);
+void gdt_init(void) {
+    gdt_init_cpu(0);
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 // idt.c
 #include <stdint.h>
 #include <arch/i386/idt.h>
+#include <arch/i386/lapic.h>
 
 struct __attribute__((packed)) idt_entry {
     uint16_t base_lo;
@@ -72,6 +73,11 @@ extern void irq13();
 extern void irq14();
 extern void irq15();
 
+// local APIC vectors, through the same irq_common path
+extern void irq32();
+extern void irq33();
+extern void irq223();
+
 void idt_set_gate(uint8_t num, uint32_t base, uint16_t sel, uint8_t flags) {
     idt[num].base_lo = base & 0xFFFF;
     idt[num].base_hi = (base >> 16) & 0xFFFF;
@@ -108,9 +114,18 @@ void idt_init(void) {
     for (int i = 0; i < 16; i++) {
         idt_set_gate((uint8_t)(32+i), (uint32_t)irqs[i], 0x08, 0x8E);
     }
+    idt_set_gate(LAPIC_VEC_TIMER, (uint32_t)irq32, 0x08, 0x8E);
+    idt_set_gate(LAPIC_VEC_RESCHED, (uint32_t)irq33, 0x08, 0x8E);
+    idt_set_gate(LAPIC_VEC_SPURIOUS, (uint32_t)irq223, 0x08, 0x8E);
+
     extern void isr128(); // stub for int 0x80
     idt_set_gate(0x80, (uint32_t)isr128, 0x08, 0xEE);
     // 0xEE = present + DPL=3 + 32-bit interrupt gate
 
     idt_load((uint32_t)&idtp);
 }
+
+// APs share the one table, they just need to point IDTR at it
+void idt_reload(void) {
+    idt_load((uint32_t)&idtp);
+}
@@ -1,24 +1,20 @@
 // isr.c
 #include <arch/i386/isr.h>
 #include <arch/i386/portio.h>
-#include <arch/i386/user_bouncing.h>
+#include <arch/i386/syscall.h>
+#include <arch/i386/thread.h>
+#include <arch/i386/proc.h>
+#include <arch/i386/lapic.h>
+#include <arch/i386/smp.h>
+#include <arch/i386/spinlock.h>
+#include <arch/i386/fpu.h>
+#include <arch/i386/uring.h>
 #include <stdio.h>
 
-extern volatile uint32_t g_user_exited;
-extern volatile uint32_t g_exec_kesp;
-extern volatile uint32_t g_exec_resume_eip;
-extern volatile uint32_t g_exec_kcr3;
-
-extern volatile uint32_t dbg_iret_eip, dbg_iret_cs, dbg_iret_eflags, dbg_iret_esp, dbg_iret_ss;
-
 // use your kernel printf
 extern int printf(const char*, ...);
 // Page fault handler
 void page_fault_handler(regs_t* r);
-// Syscall handler for userspace
-// extern void syscall_handle(regs_t* r);
-// Return to kernel asm
-extern void usermode_return_to_kernel(void) __attribute__((noreturn));
 
 static const char* exc_names[32] = {
     "Divide-by-zero","Debug","NMI","Breakpoint","Overflow","Bound Range",
@@ -30,30 +26,24 @@ static const char* exc_names[32] = {
     "Security","Reserved"
 };
 
-/*
-static __attribute__((noreturn)) 
-void exec_bounce_to_kernel(void) {
-    asm volatile(
-        "cli\n"
-        "mov %0, %%esp\n"
-        "jmp *%1\n"
-        :
-        : "r"(g_exec_kesp), "r"(g_exec_resume_eip)
-        : "memory"
-    );
-    __builtin_unreachable();
-}
-*/
-
-void isr_handler(regs_t* r) {
+static void isr_dispatch(regs_t* r) {
     //terminal_putchar('S');
     if (r->int_no == 14) {
-        page_fault_handler(r);
+        page_fault_handler(r);  // only returns if the fault was fixed up
+        return;
     }
     if (r->int_no == 128) {
-        isr128_handler(r);
+        syscall_handle(r);
         return;
     }
+    // Device Not Available: first FPU/SSE use since the last switch
+    if (r->int_no == 7 && fpu_trap()) return;
+
+    // a faulting process only takes itself down
+    if (r->int_no < 32 && (r->cs & 3) == 3 && proc_current()) {
+        printf("\n[pid %u] %s at eip=%x, killed\n", proc_current()->pid, exc_names[r->int_no], r->eip);
+        proc_exit(-1);
+    }
 
     if (r->int_no < 32) {
         printf("\n\n[EXCEPTION %u] %s  err=%u\n", r->int_no, exc_names[r->int_no], r->err_code);
@@ -65,6 +55,17 @@ void isr_handler(regs_t* r) {
     }
 }
 
+// exceptions and int 0x80 run under the BKL (see smp.h); paths that don't
+// return (proc_exit) drop it in schedule()
+void isr_handler(regs_t* r) {
+    int from_user = (r->cs & 3) == 3;
+    if (from_user) sched_acct_kernel_entry();
+    bkl_lock();
+    isr_dispatch(r);
+    bkl_unlock();
+    if (from_user) sched_acct_user_return();
+}
+
 static inline void pic_send_eoi(unsigned int int_no) {
     // IRQs are mapped to 0x20..0x2F
     if (int_no >= 0x28) outb(0xA0, 0x20); // slave PIC
@@ -74,43 +75,71 @@ static inline void pic_send_eoi(unsigned int int_no) {
 // Simple IRQ dispatch table
 typedef void (*irq_fn)(regs_t*);
 static irq_fn irq_routines[16] = {0};
+static spinlock_t g_irq_lock = SPINLOCK_INIT;
 
-void irq_install_handler(int irq, irq_fn fn) { irq_routines[irq] = fn; }
-void irq_uninstall_handler(int irq) { irq_routines[irq] = 0; }
+void irq_init(void) {
+    spin_init(&g_irq_lock, "irq routines");
+}
 
-void irq_handler(regs_t* r) {
-    //erminal_putchar('Q');
+void irq_install_handler(int irq, irq_fn fn) {
+    uint32_t f = spin_lock_irqsave(&g_irq_lock);
+    irq_routines[irq] = fn;
+    spin_unlock_irqrestore(&g_irq_lock, f);
+}
+
+void irq_uninstall_handler(int irq) {
+    uint32_t f = spin_lock_irqsave(&g_irq_lock);
+    irq_routines[irq] = 0;
+    spin_unlock_irqrestore(&g_irq_lock, f);
+}
+
+// Local APIC vectors: per-CPU tick and resched IPI. Scheduler state is per
+// CPU under its own locks, so these don't need the BKL.
+static void lapic_irq(regs_t* r) {
+    if (r->int_no == LAPIC_VEC_SPURIOUS) return;   // no EOI for spurious
+    if (r->int_no == LAPIC_VEC_TIMER) sched_tick();
+    // LAPIC_VEC_RESCHED: the wakeup already set need_resched, just get here
+    lapic_eoi();
+    sched_preempt();
+}
+
+static void pic_irq(regs_t* r) {
+    bkl_lock();
     int irq = (int)r->int_no - 32;
 
-    if (irq >= 0 && irq < 16 && irq_routines[irq]) {
-        irq_routines[irq](r);
+    // look the handler up under the lock, run it outside (it may be the shell)
+    irq_fn fn = 0;
+    if (irq >= 0 && irq < 16) {
+        spin_lock(&g_irq_lock);
+        fn = irq_routines[irq];
+        spin_unlock(&g_irq_lock);
     }
+    if (fn) fn(r);
 
     // Send EOI
     //if (r->int_no >= 40) outb(0xA0, 0x20);
     //outb(0x20, 0x20);
 
     pic_send_eoi(r->int_no);
+    bkl_unlock();
+
+    // after EOI, or the PIC holds back the next tick while another thread runs;
+    // after our unlock, so the BKL check sees only what we interrupted
+    sched_preempt();
 }
 
-void isr128_handler(regs_t* r) {
-    // convention: eax = syscall number, ebx/ecx/edx = args
-    // for testing: syscall 1 => print a char in BL
-    if (r->eax == 1) {
-        putchar((char)(r->ebx & 0xFF));
-        return;
-    }
+void irq_handler(regs_t* r) {
+    //erminal_putchar('Q');
+    // user time runs up to here; a switch away below is charged as kernel time
+    int from_user = (r->cs & 3) == 3;
+    if (from_user) sched_acct_kernel_entry();
 
-    // syscall 2 => print string at user pointer EBX (unsafe!!!) -> need copy + validation
-    if (r->eax == 2) { // exit(code)
-        printf("\n[proc exited]\n");
-        printf("exit: useresp=%x saved_kesp=%x resume=%x\n",
-            (uint32_t)r->useresp, (uint32_t)g_exec_kesp, (uint32_t)g_exec_resume_eip);
-        printf("IRET frame: eip=%x cs=%x eflags=%x esp=%x ss=%x\n",
-            dbg_iret_eip, dbg_iret_cs, dbg_iret_eflags, dbg_iret_esp, dbg_iret_ss);
-        g_user_exited = 1;
-        return;
-    }
+    if (r->int_no >= LAPIC_VEC_TIMER) lapic_irq(r);
+    else pic_irq(r);
 
-    return;
+    if (from_user) {
+        // the IRQ is over (EOI sent, BKL dropped); this is process context
+        uring_poll_user();
+        sched_acct_user_return();
+    }
 }
@@ -0,0 +1,189 @@
+// smp.c
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <arch/i386/cpu.h>
+#include <arch/i386/gdt.h>
+#include <arch/i386/tss.h>
+#include <arch/i386/idt.h>
+#include <arch/i386/pat.h>
+#include <arch/i386/fpu.h>
+#include <arch/i386/paging.h>
+#include <arch/i386/sysenter.h>
+#include <arch/i386/timer.h>
+#include <arch/i386/lapic.h>
+#include <arch/i386/spinlock.h>
+#include <arch/i386/thread.h>
+#include <arch/i386/smp.h>
+#include <arch/i386/wait.h>
+
+// Below the boot sector, in the first MB the PMM never hands out.
+// SIPI takes a page number, so it has to be page-aligned. Keep in sync
+// with smp_trampoline.S.
+#define SMP_TRAMPOLINE_BASE 0x7000u
+#define AP_STACK_SIZE       8192u
+// how long the BSP waits for APs to show up, in PIT ticks
+#define SMP_BOOT_TICKS      20u
+
+extern uint8_t smp_trampoline_start[], smp_trampoline_end[];
+extern uint8_t smp_tramp_cr3[], smp_tramp_entry[], smp_tramp_stacks[], smp_tramp_count[];
+extern uint8_t smp_tramp_cpu_max[];
+
+// where a trampoline parameter lives in the copy
+#define TRAMP_VAR(sym) \
+    ((volatile uint32_t*)(SMP_TRAMPOLINE_BASE + (uint32_t)((sym) - smp_trampoline_start)))
+
+typedef struct {
+    uint32_t apic_id;
+    volatile int online;
+} cpu_info_t;
+
+static cpu_info_t g_cpu[CPU_MAX];
+static uint32_t g_ncpu = 1;
+static uint8_t g_ap_stacks[CPU_MAX][AP_STACK_SIZE] __attribute__((aligned(16)));
+static uint32_t g_ap_stack_top[CPU_MAX];
+
+static spinlock_t g_bkl = SPINLOCK_INIT;
+static volatile uint32_t g_bkl_owner = 0xFFFFFFFFu;
+static uint32_t g_bkl_depth = 0;
+
+void bkl_lock(void) {
+    uint32_t f = irq_save();
+    uint32_t me = cpu_id();
+    if (g_bkl_owner == me) {
+        g_bkl_depth++;
+    } else {
+        spin_lock(&g_bkl);
+        g_bkl_owner = me;
+        g_bkl_depth = 1;
+    }
+    irq_restore(f);
+}
+
+void bkl_unlock(void) {
+    uint32_t f = irq_save();
+    if (g_bkl_owner == cpu_id() && --g_bkl_depth == 0) {
+        g_bkl_owner = 0xFFFFFFFFu;
+        spin_unlock(&g_bkl);
+    }
+    irq_restore(f);
+}
+
+// IRQs off (schedule)
+uint32_t bkl_release_all(void) {
+    if (g_bkl_owner != cpu_id()) return 0;
+    uint32_t depth = g_bkl_depth;
+    g_bkl_depth = 0;
+    g_bkl_owner = 0xFFFFFFFFu;
+    spin_unlock(&g_bkl);
+    return depth;
+}
+
+int bkl_held(void) {
+    return g_bkl_owner == cpu_id();
+}
+
+void bkl_reacquire(uint32_t depth) {
+    if (!depth) return;
+    uint32_t f = irq_save();
+    spin_lock(&g_bkl);
+    g_bkl_owner = cpu_id();
+    g_bkl_depth = depth;
+    irq_restore(f);
+}
+
+// First C code on an AP: paging is on, IF=0, we're on g_ap_stacks[cpu]
+__attribute__((noreturn))
+static void ap_main(uint32_t cpu) {
+    gdt_init_cpu(cpu);
+    tss_init_cpu(cpu);
+    tss_set_kernel_stack(g_ap_stack_top[cpu]);
+    tss_flush((uint16_t)GDT_TSS_SEL(cpu));   // cpu_id() is right from here on
+    idt_reload();
+    paging_init_cpu();
+
+    lapic_init_ap();
+    sysenter_init_cpu();
+    pat_init_cpu();
+    fpu_init_cpu();
+    g_cpu[cpu].apic_id = lapic_id();
+
+    // this boot context becomes the CPU's idle thread
+    sched_init_cpu();
+    lapic_timer_start();
+    __atomic_store_n(&g_cpu[cpu].online, 1, __ATOMIC_RELEASE);
+    sched_idle();
+}
+
+
+void smp_init(void) {
+    spin_init(&g_bkl, "bkl");
+    g_cpu[0].online = 1;
+    if (!lapic_init()) {
+        printf("smp: no local APIC, 1 CPU\n");
+        return;
+    }
+    g_cpu[0].apic_id = lapic_id();
+    lapic_timer_calibrate();
+
+    for (uint32_t i = 1; i < CPU_MAX; i++) {
+        g_ap_stack_top[i] = (uint32_t)(g_ap_stacks[i] + AP_STACK_SIZE);
+    }
+    memcpy((void*)SMP_TRAMPOLINE_BASE, smp_trampoline_start,
+           (size_t)(smp_trampoline_end - smp_trampoline_start));
+    *TRAMP_VAR(smp_tramp_cr3) = (uint32_t)paging_kernel_directory().pd_phys;
+    *TRAMP_VAR(smp_tramp_entry) = (uint32_t)ap_main;
+    *TRAMP_VAR(smp_tramp_stacks) = (uint32_t)g_ap_stack_top;
+    *TRAMP_VAR(smp_tramp_count) = 0;
+    *TRAMP_VAR(smp_tramp_cpu_max) = CPU_MAX;
+
+    // No MADT walk: broadcast INIT-SIPI-SIPI and let whoever is there count
+    // itself in. An AP that took the first SIPI ignores the second.
+    lapic_send_init_all();
+    thread_sleep(1);                                  // >= 10ms
+    lapic_send_sipi_all(SMP_TRAMPOLINE_BASE >> 12);
+    thread_sleep(1);                                  // >= 200us
+    lapic_send_sipi_all(SMP_TRAMPOLINE_BASE >> 12);
+
+    uint32_t arrived = 0;
+    for (uint32_t t = 0; t < SMP_BOOT_TICKS; t++) {
+        thread_sleep(1);
+        arrived = *TRAMP_VAR(smp_tramp_count);
+        if (arrived >= CPU_MAX - 1) break;
+    }
+    if (arrived > CPU_MAX - 1) {
+        printf("smp: %u APs, using %u\n", arrived, CPU_MAX - 1);
+        arrived = CPU_MAX - 1;
+    }
+
+    // they've got their index, now let them finish setting up
+    uint32_t n = 1;
+    for (uint32_t i = 1; i <= arrived; i++) {
+        for (uint32_t t = 0; t < SMP_BOOT_TICKS && !g_cpu[i].online; t++) thread_sleep(1);
+        if (g_cpu[i].online) n++;
+        else printf("smp: cpu %u didn't come up\n", i);
+    }
+    g_ncpu = n;
+
+    printf("smp: %u CPU%s online\n", g_ncpu, g_ncpu == 1 ? "" : "s");
+    for (uint32_t i = 0; i < CPU_MAX; i++) {
+        if (g_cpu[i].online) printf("  cpu%u apic %u\n", i, g_cpu[i].apic_id);
+    }
+}
+
+uint32_t smp_cpu_count(void) {
+    return g_ncpu;
+}
+
+int smp_cpu_online(uint32_t cpu) {
+    return cpu < CPU_MAX && g_cpu[cpu].online;
+}
+
+uint32_t smp_apic_id(uint32_t cpu) {
+    return cpu < CPU_MAX ? g_cpu[cpu].apic_id : 0;
+}
+
+void smp_send_resched(uint32_t cpu) {
+    if (cpu == cpu_id() || !smp_cpu_online(cpu) || !lapic_present()) return;
+    lapic_send_ipi(g_cpu[cpu].apic_id, LAPIC_VEC_RESCHED);
+}
@@ -0,0 +1,44 @@
+// spinlock.c
+#include <stdint.h>
+#include <arch/i386/cpu.h>
+#include <arch/i386/spinlock.h>
+
+int g_spin_tsc = 0;
+static spinlock_t* g_locks = 0;
+
+void spin_init(spinlock_t* l, const char* name) {
+    if (cpuid_edx(1) & CPUID_EDX_TSC) g_spin_tsc = 1;
+    l->name = name;
+
+    // lock-free push: spin_init can run on several CPUs at once
+    spinlock_t* head = __atomic_load_n(&g_locks, __ATOMIC_RELAXED);
+    do {
+        l->list_next = head;
+    } while (!__atomic_compare_exchange_n(&g_locks, &head, l, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+spinlock_t* spin_lock_list(void) {
+    return __atomic_load_n(&g_locks, __ATOMIC_ACQUIRE);
+}
+
+// Out of line so the uncontended path stays a fetch_add and a compare
+void spin_wait(spinlock_t* l, uint32_t ticket) {
+    uint32_t spins = 0;
+    while (__atomic_load_n(&l->owner, __ATOMIC_ACQUIRE) != ticket) {
+        __asm__ volatile ("pause" ::: "memory");
+        spins++;
+    }
+    // ours now, so the counters are too
+    l->contended++;
+    l->spins += spins;
+}
+
+void spin_stats_reset(void) {
+    // racy against holders, good enough for counters
+    for (spinlock_t* l = spin_lock_list(); l; l = l->list_next) {
+        l->acquires = 0;
+        l->contended = 0;
+        l->spins = 0;
+        l->hold_max = 0;
+    }
+}
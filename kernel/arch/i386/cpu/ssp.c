@@ -1,5 +1,6 @@
 #include <stdint.h>
 #include <stdio.h>
+#include <kernel/tty.h>
 
 __attribute__((used))
 uintptr_t __stack_chk_guard = 0;
@@ -24,8 +25,7 @@ void ssp_init(void) {
 // GCC will call this when it sees stack corruption
 __attribute__((noreturn))
 void __stack_chk_fail(void) {
-    volatile uint16_t* vga = (uint16_t*)0xB8000;
-    vga[0] = (0x4F << 8) | '!';   // red '!' at top-left
+    terminal_putentryat('!', 0x4F, 0, 0);   // red '!' at top-left
     // Will not run, gcc cannot deal with stack corruption yet
     printf("\n\n*** STACK SMASH DETECTED ***\n");
     printf("Halting.\n");
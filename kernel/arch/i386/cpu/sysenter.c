@@ -0,0 +1,66 @@
+// sysenter.c
+#include <stdint.h>
+#include <stdio.h>
+#include <arch/i386/cpu.h>
+#include <arch/i386/tss.h>
+#include <arch/i386/isr.h>
+#include <arch/i386/uaccess.h>
+#include <arch/i386/proc.h>
+#include <arch/i386/smp.h>
+#include <arch/i386/sysenter.h>
+#include <arch/i386/syscall.h>
+#include <arch/i386/timer.h>
+#include <sys/vtime.h>
+
+extern void sysenter_entry(void);
+
+static int g_sysenter = 0;
+
+int sysenter_supported(void) {
+    return g_sysenter;
+}
+
+// MSRs are per CPU, and ESP points at this CPU's own tss.esp0
+void sysenter_init_cpu(void) {
+    if (!g_sysenter) return;
+    // SS = CS+8, user CS = CS+16, user SS = CS+24 -- matches our GDT layout
+    wrmsr(MSR_IA32_SYSENTER_CS, 0x08);
+    wrmsr(MSR_IA32_SYSENTER_ESP, (uint32_t)tss_kernel_stack_slot());
+    wrmsr(MSR_IA32_SYSENTER_EIP, (uint32_t)sysenter_entry);
+}
+
+int sysenter_init(void) {
+    uint32_t a, b, c, d;
+    cpuid(1, &a, &b, &c, &d);
+
+    // Pentium Pro reports SEP but doesn't implement it (family 6, model < 3, stepping < 3)
+    uint32_t family = (a >> 8) & 0xF, model = (a >> 4) & 0xF, stepping = a & 0xF;
+    if (!(d & CPUID_EDX_SEP) || (family == 6 && model < 3 && stepping < 3)) {
+        printf("sysenter: not supported, int 0x80 only\n");
+        return 0;
+    }
+
+    g_sysenter = 1;
+    sysenter_init_cpu();
+    // libc's syscall stubs fall back to int 0x80 without this
+    vtime_set_features(VTIME_F_SYSENTER);
+    printf("sysenter: enabled\n");
+    return 1;
+}
+
+void sysenter_handler(regs_t* r) {
+    sched_acct_kernel_entry();
+    bkl_lock();
+    // return eip sits at the top of the user stack (ebp), pop it
+    uint32_t ret;
+    if (copy_from_user(&ret, (const void*)r->useresp, sizeof(ret)) < 0) {
+        printf("\n[sysenter] bad user stack %x, killing\n", r->useresp);
+        proc_exit(-1);
+    }
+    r->eip = ret;
+    r->useresp += 4;
+
+    syscall_handle(r);
+    bkl_unlock();
+    sched_acct_user_return();
+}
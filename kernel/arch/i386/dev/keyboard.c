@@ -7,6 +7,8 @@
 #include <arch/i386/isr.h>     // for regs_t and handler typedef (whatever yours is)
 #include <kernel/tty.h>        // terminal_putchar / terminal_write / etc (from your meaty skeleton)
 #include <kernel/shell.h>
+#include <arch/i386/workqueue.h>
+#include <arch/i386/wait.h>
 
 // ===== Adjust these if your project uses different names =====
 // After PIC remap(0x20,0x28): IRQ1 is vector 0x21 (33)
@@ -37,6 +39,17 @@ static volatile bool g_caps  = false;
 
 static bool shell_enabled = false;
 
+// IRQ1 only reads the scancode into this ring and queues kbd_work; the
+// decoding, echo and the shell itself run in kworker. One producer (IRQ1,
+// BSP) and one consumer (kworker), so head/tail need no lock.
+#define KBD_RING_SIZE 64u
+static volatile uint8_t g_sc_ring[KBD_RING_SIZE];
+static volatile uint32_t g_sc_head = 0;   // written by the IRQ
+static volatile uint32_t g_sc_tail = 0;   // written by kworker
+
+static void kbd_work(void* arg);
+static work_t g_kbd_work = WORK_INIT(kbd_work, 0);
+
 // Basic US keymap (set 1). Index = scancode (0..127).
 // Only includes printable keys you care about right now.
 static const char keymap[128] = {
@@ -106,12 +119,7 @@ static inline char apply_caps_shift(char c, bool shift, bool caps) {
     return c;
 }
 
-void keyboard_irq(regs_t* r) {
-    //terminal_putchar('.');
-    (void)r;
-
-    // Read scancode
-    uint8_t sc = inb(0x60);
+static void kbd_scancode(uint8_t sc) {
 
     // Handle 0xE0 extended prefix: for now, ignore next byte
     // (arrow keys, etc.). This keeps things simple and prevents weirdness.
@@ -170,6 +178,31 @@ void keyboard_irq(regs_t* r) {
     line_push(c);
 }
 
+static void kbd_work(void* arg) {
+    (void)arg;
+    while (g_sc_tail != __atomic_load_n(&g_sc_head, __ATOMIC_ACQUIRE)) {
+        uint8_t sc = g_sc_ring[g_sc_tail % KBD_RING_SIZE];
+        __atomic_store_n(&g_sc_tail, g_sc_tail + 1, __ATOMIC_RELEASE);
+        kbd_scancode(sc);      // Enter runs the whole shell command from here
+    }
+}
+
+void keyboard_irq(regs_t* r) {
+    //terminal_putchar('.');
+    (void)r;
+
+    // Read scancode
+    uint8_t sc = inb(0x60);
+
+    uint32_t head = g_sc_head;
+    // full ring (a long command and a lot of typing): drop the key
+    if (head - __atomic_load_n(&g_sc_tail, __ATOMIC_ACQUIRE) < KBD_RING_SIZE) {
+        g_sc_ring[head % KBD_RING_SIZE] = sc;
+        __atomic_store_n(&g_sc_head, head + 1, __ATOMIC_RELEASE);
+    }
+    work_queue(&g_kbd_work);
+}
+
 void keyboard_init(void) {
     // vector 33 after PIC remap(0x20,0x28)
     // Doesnt matter since it is automapped in irq
@@ -184,24 +217,44 @@ void keyboard_enable_shell(bool on) {
     if (on) line_reset();
 }
 
-static inline void ps2_wait_input_clear(void) {
-    while (inb(0x64) & 2) {}
+// The controller has no interrupt for "ready to take a byte" (and IRQ1 is
+// what we're configuring), so these poll the status port: a short burst,
+// then a tick of sleep before the next one, instead of spinning the CPU.
+// A controller that never gets ready gives up after PS2_TIMEOUT_TICKS.
+#define PS2_POLL_BURST    1000
+#define PS2_TIMEOUT_TICKS 10
+
+static int ps2_wait_status(uint8_t mask, uint8_t want) {
+    for (uint32_t t = 0; t <= PS2_TIMEOUT_TICKS; t++) {
+        for (int i = 0; i < PS2_POLL_BURST; i++) {
+            if ((inb(0x64) & mask) == want) return 0;
+        }
+        thread_sleep(1);
+    }
+    return -1;
 }
-static inline void ps2_wait_output_full(void) {
-    while ((inb(0x64) & 1) == 0) {}
+
+static inline int ps2_wait_input_clear(void) {
+    return ps2_wait_status(2, 0);
+}
+static inline int ps2_wait_output_full(void) {
+    return ps2_wait_status(1, 1);
 }
 
-static inline void ps2_cmd(uint8_t cmd) {
-    ps2_wait_input_clear();
+static inline int ps2_cmd(uint8_t cmd) {
+    if (ps2_wait_input_clear() < 0) return -1;
     outb(0x64, cmd);
+    return 0;
 }
-static inline uint8_t ps2_read_data(void) {
-    ps2_wait_output_full();
-    return inb(0x60);
+static inline int ps2_read_data(uint8_t* out) {
+    if (ps2_wait_output_full() < 0) return -1;
+    *out = inb(0x60);
+    return 0;
 }
-static inline void ps2_write_data(uint8_t data) {
-    ps2_wait_input_clear();
+static inline int ps2_write_data(uint8_t data) {
+    if (ps2_wait_input_clear() < 0) return -1;
     outb(0x60, data);
+    return 0;
 }
 
 static void ps2_flush(void) {
@@ -211,16 +264,21 @@ static void ps2_flush(void) {
 void ps2_enable_irq1_only(void) {
     ps2_flush();
 
-    ps2_cmd(0xAE);        // enable first port
-
-    ps2_cmd(0x20);        // read config byte
-    uint8_t cfg = ps2_read_data();
+    uint8_t cfg;
+    if (ps2_cmd(0xAE) < 0 ||        // enable first port
+        ps2_cmd(0x20) < 0 ||        // read config byte
+        ps2_read_data(&cfg) < 0) {
+        printf("ps2: controller not responding\n");
+        return;
+    }
 
     cfg |= 0x01;          // set bit0 = IRQ1 enable
     // DO NOT change any other bits (especially bit6 translation)
 
-    ps2_cmd(0x60);        // write config byte
-    ps2_write_data(cfg);
+    if (ps2_cmd(0x60) < 0 || ps2_write_data(cfg) < 0) {   // write config byte
+        printf("ps2: config write timed out\n");
+        return;
+    }
 
     ps2_flush();
 }
@@ -0,0 +1,147 @@
+// lapic.c
+#include <stdint.h>
+#include <stdio.h>
+#include <arch/i386/cpu.h>
+#include <arch/i386/paging.h>
+#include <arch/i386/timer.h>
+#include <arch/i386/lapic.h>
+
+#define MSR_IA32_APIC_BASE 0x1Bu
+#define APIC_BASE_ENABLE   (1u << 11)
+#define CPUID_EDX_APIC     (1u << 9)
+
+// register offsets
+#define LAPIC_ID        0x020u
+#define LAPIC_TPR       0x080u
+#define LAPIC_EOI       0x0B0u
+#define LAPIC_SVR       0x0F0u
+#define LAPIC_ESR       0x280u
+#define LAPIC_ICR_LO    0x300u
+#define LAPIC_ICR_HI    0x310u
+#define LAPIC_LVT_TIMER 0x320u
+#define LAPIC_LVT_LINT0 0x350u
+#define LAPIC_LVT_LINT1 0x360u
+#define LAPIC_TIMER_INIT 0x380u
+#define LAPIC_TIMER_CUR 0x390u
+#define LAPIC_TIMER_DIV 0x3E0u
+
+#define SVR_ENABLE      (1u << 8)
+#define LVT_MASKED      (1u << 16)
+#define LVT_PERIODIC    (1u << 17)
+#define LVT_EXTINT      (7u << 8)
+#define LVT_NMI         (4u << 8)
+#define ICR_INIT        (5u << 8)
+#define ICR_STARTUP     (6u << 8)
+#define ICR_PENDING     (1u << 12)
+#define ICR_ASSERT      (1u << 14)
+#define ICR_ALL_BUT_SELF (3u << 18)
+#define TIMER_DIV_16    0x3u
+
+// PIT ticks the calibration runs over
+#define LAPIC_CAL_TICKS 10u
+
+static volatile uint32_t* g_lapic = 0;
+static uint32_t g_timer_per_tick = 0;
+
+static inline uint32_t lapic_read(uint32_t reg) {
+    return g_lapic[reg / 4];
+}
+
+static inline void lapic_write(uint32_t reg, uint32_t v) {
+    g_lapic[reg / 4] = v;
+    (void)g_lapic[LAPIC_ID / 4];    // read back so the write is posted before we go on
+}
+
+static void lapic_enable(void) {
+    lapic_write(LAPIC_TPR, 0);
+    lapic_write(LAPIC_SVR, SVR_ENABLE | LAPIC_VEC_SPURIOUS);
+}
+
+int lapic_init(void) {
+    if (!(cpuid_edx(1) & CPUID_EDX_APIC) || !(cpuid_edx(1) & CPUID_EDX_MSR)) return 0;
+
+    uint64_t base = rdmsr(MSR_IA32_APIC_BASE);
+    uint32_t phys = (uint32_t)base & 0xFFFFF000u;
+    wrmsr(MSR_IA32_APIC_BASE, base | APIC_BASE_ENABLE);
+
+    // 0xFEE00000 is in the shared high PDEs, so every later clone sees it
+    if (paging_map(phys, phys, P_PRESENT | P_RW | P_PCD | P_PWT) < 0) return 0;
+    g_lapic = (volatile uint32_t*)phys;
+
+    lapic_enable();
+    // virtual wire: the 8259 still drives the BSP through LINT0
+    lapic_write(LAPIC_LVT_LINT0, LVT_EXTINT);
+    lapic_write(LAPIC_LVT_LINT1, LVT_NMI);
+    lapic_write(LAPIC_LVT_TIMER, LVT_MASKED);
+    printf("lapic: id %u at %x\n", lapic_id(), phys);
+    return 1;
+}
+
+void lapic_init_ap(void) {
+    wrmsr(MSR_IA32_APIC_BASE, rdmsr(MSR_IA32_APIC_BASE) | APIC_BASE_ENABLE);
+    lapic_enable();
+    lapic_write(LAPIC_LVT_LINT0, LVT_MASKED);
+    lapic_write(LAPIC_LVT_LINT1, LVT_MASKED);
+    lapic_write(LAPIC_LVT_TIMER, LVT_MASKED);
+    lapic_write(LAPIC_ESR, 0);
+    lapic_eoi();
+}
+
+int lapic_present(void) {
+    return g_lapic != 0;
+}
+
+uint32_t lapic_id(void) {
+    return g_lapic ? lapic_read(LAPIC_ID) >> 24 : 0;
+}
+
+void lapic_eoi(void) {
+    g_lapic[LAPIC_EOI / 4] = 0;
+}
+
+static void icr_send(uint32_t hi, uint32_t lo) {
+    uint32_t f = irq_save();
+    while (lapic_read(LAPIC_ICR_LO) & ICR_PENDING) __asm__ volatile ("pause");
+    lapic_write(LAPIC_ICR_HI, hi);
+    lapic_write(LAPIC_ICR_LO, lo);
+    while (lapic_read(LAPIC_ICR_LO) & ICR_PENDING) __asm__ volatile ("pause");
+    irq_restore(f);
+}
+
+void lapic_send_ipi(uint32_t apic_id, uint8_t vector) {
+    icr_send(apic_id << 24, ICR_ASSERT | vector);
+}
+
+void lapic_send_init_all(void) {
+    icr_send(0, ICR_ALL_BUT_SELF | ICR_ASSERT | ICR_INIT);
+}
+
+void lapic_send_sipi_all(uint8_t page) {
+    icr_send(0, ICR_ALL_BUT_SELF | ICR_ASSERT | ICR_STARTUP | page);
+}
+
+static void wait_tick_edge(void) {
+    uint64_t t = timer_ticks();
+    while (timer_ticks() == t) __asm__ volatile ("hlt");
+}
+
+void lapic_timer_calibrate(void) {
+    lapic_write(LAPIC_TIMER_DIV, TIMER_DIV_16);
+    lapic_write(LAPIC_LVT_TIMER, LVT_MASKED);
+
+    wait_tick_edge();
+    lapic_write(LAPIC_TIMER_INIT, 0xFFFFFFFFu);
+    for (uint32_t i = 0; i < LAPIC_CAL_TICKS; i++) wait_tick_edge();
+    uint32_t left = lapic_read(LAPIC_TIMER_CUR);
+    lapic_write(LAPIC_TIMER_INIT, 0);
+
+    g_timer_per_tick = (0xFFFFFFFFu - left) / LAPIC_CAL_TICKS;
+    printf("lapic: timer %u counts per tick\n", g_timer_per_tick);
+}
+
+void lapic_timer_start(void) {
+    if (!g_timer_per_tick) return;
+    lapic_write(LAPIC_TIMER_DIV, TIMER_DIV_16);
+    lapic_write(LAPIC_LVT_TIMER, LVT_PERIODIC | LAPIC_VEC_TIMER);
+    lapic_write(LAPIC_TIMER_INIT, g_timer_per_tick);
+}
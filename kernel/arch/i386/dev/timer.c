@@ -1,38 +1,117 @@
 // timer.c
 #include <stdint.h>
+#include <sys/vtime.h>
 #include <arch/i386/portio.h>
 #include <arch/i386/isr.h>
+#include <arch/i386/cpu.h>
+#include <arch/i386/paging.h>
+#include <arch/i386/timer.h>
+#include <arch/i386/uring.h>
+#include <arch/i386/thread.h>
+#include <arch/i386/workqueue.h>
 
 extern int printf(const char*, ...);
 extern void irq_install_handler(int irq, void (*fn)(regs_t*));
 
+// TSC is calibrated over this many ticks after boot
+#define TSC_CAL_TICKS 16
+
 static volatile uint64_t ticks = 0;
+static uint32_t g_hz = 0;
+static int g_tsc = 0;
+static uint64_t g_cal_tsc0 = 0;
+
+// Lives in the kernel image, so it is identity-mapped in every directory
+// and the IRQ can write it whatever CR3 is loaded. Users see it read-only.
+// A whole page of its own so nothing else in .bss leaks to user space.
+static union {
+    struct vtime_page v;
+    uint8_t page[PAGE_SIZE];
+} g_vtime_page __attribute__((aligned(PAGE_SIZE)));
+#define g_vtime g_vtime_page.v
+
+// 64-bit reads aren't atomic on i386, and the IRQ runs on the BSP while
+// these are read from any CPU: retry like the user side of the time page.
+// Only ever written in vtime_update, inside the seq window.
+#define VTIME_READ(expr) ({                                         \
+    uint32_t _s;                                                    \
+    uint64_t _v;                                                    \
+    do {                                                            \
+        _s = g_vtime.seq;                                           \
+        __asm__ volatile ("" ::: "memory");                         \
+        _v = (expr);                                                \
+        __asm__ volatile ("" ::: "memory");                         \
+    } while ((_s & 1) || _s != g_vtime.seq);                        \
+    _v;                                                             \
+})
 
-uint32_t timer_ticks(void) { 
-    return ticks; 
+uint64_t timer_ticks(void) {
+    return VTIME_READ(ticks);
 }
 
-static void timer_cb(regs_t* r) {
-    (void)r;
+uint32_t timer_hz(void) {
+    return g_hz;
+}
+
+uint64_t timer_tsc_per_tick(void) {
+    return VTIME_READ(g_vtime.tsc_per_tick);
+}
+
+int vtime_map(page_directory_t dir) {
+    return paging_map_in(dir, VTIME_VA, (uint32_t)&g_vtime, P_PRESENT | P_USER | P_SHARED);
+}
+
+void vtime_set_features(uint32_t f) {
+    g_vtime.features |= f;
+}
+
+static void vtime_update(void) {
+    uint64_t now = g_tsc ? rdtsc() : 0;
+
+    g_vtime.seq++;                                 // odd: update in progress
+    __asm__ volatile ("" ::: "memory");
     ticks++;
+    g_vtime.ticks = ticks;
+    g_vtime.tsc_at_tick = now;
+    if (g_tsc && ticks == 1) g_cal_tsc0 = now;
+    if (g_tsc && ticks == 1 + TSC_CAL_TICKS) g_vtime.tsc_per_tick = (now - g_cal_tsc0) / TSC_CAL_TICKS;
+    __asm__ volatile ("" ::: "memory");
+    g_vtime.seq++;
+}
+
+// the heartbeat dot goes through the console, which isn't IRQ business:
+// a deferred timer that re-arms itself once a second
+static ktimer_t g_heartbeat;
+static void heartbeat(void* arg) {
+    (void)arg;
+    putchar('.');
+    timer_add(&g_heartbeat, g_hz);
+}
+
+static void timer_cb(regs_t* r) {
+    vtime_update();
+    uring_poll_tick(r);
+    timer_wheel_tick(ticks);
+    sched_tick();
     // uncomment if you want a tick
     //if ((ticks % 100) == 0) printf("[tick %llu]\n", ticks);
-    if ((ticks % 100) == 0) putchar('.');
 }
 
 void timer_init(uint32_t hz) {
     // PIT base frequency
     uint32_t divisor = 1193180 / hz;
 
+    timer_wheel_init();
+    g_hz = hz;
+    g_tsc = (cpuid_edx(1) & CPUID_EDX_TSC) ? 1 : 0;
+    g_vtime.hz = hz;
+
     outb(0x43, 0x36);
     outb(0x40, (uint8_t)(divisor & 0xFF));
     outb(0x40, (uint8_t)((divisor >> 8) & 0xFF));
 
+    timer_setup(&g_heartbeat, heartbeat, 0, KTIMER_DEFERRED);
+    timer_add(&g_heartbeat, hz);
+
     irq_install_handler(0, timer_cb); // IRQ0
 }
-
-static void timer_irq(regs_t* r) {
-    (void)r;
-    ticks++;
-    if ((ticks % 100) == 0) putchar('.');   // prints dot periodically
-}
\ No newline at end of file
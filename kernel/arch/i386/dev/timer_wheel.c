@@ -0,0 +1,160 @@
+// timer_wheel.c
+#include <stdint.h>
+#include <string.h>
+#include <arch/i386/cpu.h>
+#include <arch/i386/smp.h>
+#include <arch/i386/spinlock.h>
+#include <arch/i386/workqueue.h>
+#include <arch/i386/timer.h>
+
+#define SLOT_MASK (TIMER_SLOTS - 1u)
+// how far past g_clk a timer can be hashed
+#define WHEEL_SPAN ((uint64_t)1 << (TIMER_SLOT_BITS * TIMER_LEVELS))
+
+// Slots are doubly linked so cancel can unlink without a walk
+static ktimer_t* g_wheel[TIMER_LEVELS][TIMER_SLOTS];
+// next tick to run; timers are hashed relative to it
+static uint64_t g_clk = 0;
+static spinlock_t g_wheel_lock = SPINLOCK_INIT;
+static timer_wheel_stat_t g_stat;
+
+// timer whose fn is being called right now (outside the lock), and where
+static ktimer_t* volatile g_running = 0;
+static volatile uint32_t g_running_cpu = 0;
+// g_clk's level-0 slot is being fired: it's no longer "the next tick", and
+// a timer hashed into it now (fn re-adding itself) would fire again at once
+static int g_firing = 0;
+
+static void wheel_insert(ktimer_t* t) {
+    uint64_t first = g_clk + (g_firing ? 1 : 0);
+    uint64_t exp = t->expires < first ? first : t->expires;
+    if (exp - g_clk >= WHEEL_SPAN) exp = g_clk + WHEEL_SPAN - 1;   // comes round again
+
+    // lowest level whose range covers the distance
+    uint32_t level = 0;
+    while (level + 1 < TIMER_LEVELS && ((exp - g_clk) >> (TIMER_SLOT_BITS * (level + 1)))) level++;
+    uint32_t slot = (uint32_t)(exp >> (TIMER_SLOT_BITS * level)) & SLOT_MASK;
+
+    ktimer_t** head = &g_wheel[level][slot];
+    t->prev = 0;
+    t->next = *head;
+    if (*head) (*head)->prev = t;
+    *head = t;
+    t->level = (uint8_t)level;
+    t->slot = (uint8_t)slot;
+    t->pending = 1;
+    g_stat.pending[level]++;
+}
+
+static void wheel_remove(ktimer_t* t) {
+    if (t->prev) t->prev->next = t->next;
+    else g_wheel[t->level][t->slot] = t->next;
+    if (t->next) t->next->prev = t->prev;
+    t->next = t->prev = 0;
+    t->pending = 0;
+    g_stat.pending[t->level]--;
+}
+
+// Empty the slot of 'level' that g_clk has just reached and hash its timers
+// again: with g_clk moved on, they land in lower levels.
+static void cascade(uint32_t level) {
+    uint32_t slot = (uint32_t)(g_clk >> (TIMER_SLOT_BITS * level)) & SLOT_MASK;
+    ktimer_t* t = g_wheel[level][slot];
+    g_wheel[level][slot] = 0;
+    while (t) {
+        ktimer_t* next = t->next;
+        g_stat.pending[level]--;
+        wheel_insert(t);
+        g_stat.cascaded++;
+        t = next;
+    }
+}
+
+static void deferred_fire(void* arg) {
+    ktimer_t* t = (ktimer_t*)arg;
+    t->fn(t->arg);
+}
+
+void timer_setup(ktimer_t* t, ktimer_fn fn, void* arg, uint32_t flags) {
+    memset(t, 0, sizeof(*t));
+    t->fn = fn;
+    t->arg = arg;
+    t->flags = flags;
+    t->work.fn = deferred_fire;
+    t->work.arg = t;
+}
+
+void timer_add(ktimer_t* t, uint32_t ticks) {
+    uint32_t f = spin_lock_irqsave(&g_wheel_lock);
+    if (t->pending) wheel_remove(t);
+    // g_clk is the tick that runs next, so ticks=0 means that one
+    t->expires = g_clk + ticks;
+    wheel_insert(t);
+    g_stat.added++;
+    spin_unlock_irqrestore(&g_wheel_lock, f);
+}
+
+int timer_cancel(ktimer_t* t) {
+    uint32_t f = spin_lock_irqsave(&g_wheel_lock);
+    if (t->pending) {
+        wheel_remove(t);
+        g_stat.cancelled++;
+        spin_unlock_irqrestore(&g_wheel_lock, f);
+        return 1;
+    }
+    int wait = g_running == t && g_running_cpu != cpu_id();
+    spin_unlock_irqrestore(&g_wheel_lock, f);
+
+    // fn is on another CPU (the BSP's IRQ0); it may be using t's memory
+    while (wait && g_running == t) __asm__ volatile ("pause");
+    return 0;
+}
+
+void timer_wheel_init(void) {
+    spin_init(&g_wheel_lock, "timer wheel");
+}
+
+// IRQ0 on the BSP: run every tick up to 'now'. Due timers are unhooked
+// under the lock and called outside it, so fn can add and cancel timers.
+void timer_wheel_tick(uint64_t now) {
+    spin_lock(&g_wheel_lock);
+    while (g_clk <= now) {
+        uint32_t slot = (uint32_t)g_clk & SLOT_MASK;
+        // level 0 came round: pull the next level's slot down, and so on up
+        for (uint32_t l = 1; l < TIMER_LEVELS; l++) {
+            if (((g_clk >> (TIMER_SLOT_BITS * (l - 1))) & SLOT_MASK) != 0) break;
+            cascade(l);
+        }
+
+        ktimer_t* t;
+        g_firing = 1;
+        while ((t = g_wheel[0][slot]) != 0) {
+            wheel_remove(t);
+            if (t->expires > g_clk) {
+                // clamped to the wheel's span when added: not due yet
+                wheel_insert(t);
+                continue;
+            }
+            g_stat.fired++;
+            if (t->flags & KTIMER_DEFERRED) {
+                work_queue(&t->work);
+                continue;
+            }
+            g_running = t;
+            g_running_cpu = cpu_id();
+            spin_unlock(&g_wheel_lock);
+            t->fn(t->arg);
+            spin_lock(&g_wheel_lock);
+            g_running = 0;
+        }
+        g_firing = 0;
+        g_clk++;
+    }
+    spin_unlock(&g_wheel_lock);
+}
+
+void timer_wheel_stat(timer_wheel_stat_t* out) {
+    uint32_t f = spin_lock_irqsave(&g_wheel_lock);
+    *out = g_stat;
+    spin_unlock_irqrestore(&g_wheel_lock, f);
+}
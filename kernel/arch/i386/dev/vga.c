@@ -1,25 +1,11 @@
+#include <kernel/tty.h>
 #include <kernel/vga.h>
 
-static volatile uint16_t* const VGA = (uint16_t*)0xB8000;
-static uint8_t row = 0;
-static uint8_t col = 0;
-static uint8_t color = 0x0F; // white on black
-
-static void vga_newline(void) {
-    col = 0;
-    if (++row >= 25) row = 24;
-}
+// Boot/panic printing. Shares the screen (and its shadow) with the terminal,
+// so these never race it for VGA memory or leave the shadow stale.
 
 void vga_putc(char c) {
-    if (c == '\n') {
-        vga_newline();
-        return;
-    }
-
-    VGA[row * 80 + col] = ((uint16_t)color << 8) | c;
-
-    if (++col >= 80)
-        vga_newline();
+    terminal_putchar(c);
 }
 
 void vga_print(const char* s) {
@@ -27,9 +13,7 @@ void vga_print(const char* s) {
 }
 
 void vga_clear(void) {
-    for (int i = 0; i < 80 * 25; i++)
-        VGA[i] = ((uint16_t)color << 8) | ' ';
-    row = col = 0;
+    terminal_initialize();
 }
 
 void vga_print_hex(uint32_t x) {
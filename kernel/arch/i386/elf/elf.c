@@ -1,117 +1,206 @@
 #include <stdint.h>
 #include <kernel/vfs.h>
-#include <arch/i386/paging.h>
 #include <kernel/elf.h>
+#include <kernel/elf_cache.h>
+#include <arch/i386/paging.h>
+#include <arch/i386/elf_load.h>
+#include <arch/i386/uvm.h>
+#include <stdio.h>
 
 #ifndef PAGE_SIZE
 #define PAGE_SIZE 0x1000u
 #endif
 
-#define USER_STACK_TOP      0x02000000u   // 32MB (outside your 0..16MB identity map)
-#define USER_STACK_PAGES    4
+// program headers live on the stack while loading
+#define ELF_MAX_PH          16
+// so does the bounce buffer: execs may sleep in the fs and overlap
+#define ELF_BOUNCE          512u
 
 static uint32_t align_down(uint32_t x) { return x & 0xFFFFF000u; }
 static uint32_t align_up(uint32_t x)   { return (x + 0xFFFu) & 0xFFFFF000u; }
 
-static int read_all(int fd, void* buf, uint32_t n) {
+static uint32_t max_u32(uint32_t a, uint32_t b) { return a > b ? a : b; }
+static uint32_t min_u32(uint32_t a, uint32_t b) { return a < b ? a : b; }
+
+// Where segment bytes come from: the resident image when the fs has one,
+// otherwise positional reads through a small bounce buffer of the caller's.
+typedef struct {
+    int fd;
+    const uint8_t* img;
+} elf_src_t;
+
+static int pread_all(int fd, uint32_t off, void* buf, uint32_t n) {
     uint8_t* p = (uint8_t*)buf;
     uint32_t got = 0;
     while (got < n) {
-        int r = vfs_read(fd, p + got, n - got);
+        int r = vfs_pread(fd, off + got, p + got, n - got);
         if (r <= 0) return -1;
         got += (uint32_t)r;
     }
     return 0;
 }
 
-// minimal: no seek yet -> we read whole file into heap
-// (good enough for initrd tiny binaries)
-extern void* kmalloc(uint32_t);
-extern void  kfree(void*);
-
-typedef struct {
-    uint32_t entry;
-    uint32_t user_stack_top;
-} user_image_t;
-
-int elf_load_from_vfs(const char* path, page_directory_t dir, user_image_t* out) {
-    int fd = vfs_open(path);
-    if (fd < 0) return -1;
-
-    // Read first page (enough for headers)
-    Elf32_Ehdr eh;
-    if (read_all(fd, &eh, sizeof(eh)) < 0) { vfs_close(fd); return -1; }
+// file bytes [off, off+len) -> user va in dir; len never crosses a page here
+static int copy_file(page_directory_t dir, const elf_src_t* src, uint32_t va, uint32_t off, uint32_t len) {
+    if (src->img) return paging_copy_to_dir(dir, va, src->img + off, len);
+
+    uint8_t bounce[ELF_BOUNCE];
+    while (len) {
+        uint32_t n = min_u32(len, ELF_BOUNCE);
+        if (pread_all(src->fd, off, bounce, n) < 0) return -1;
+        if (paging_copy_to_dir(dir, va, bounce, n) < 0) return -1;
+        va += n;
+        off += n;
+        len -= n;
+    }
+    return 0;
+}
 
-    // validate ELF magic
-    if (eh.e_ident[0] != 0x7F || eh.e_ident[1] != 'E' || eh.e_ident[2] != 'L' || eh.e_ident[3] != 'F') {
-        vfs_close(fd);
-        return -1;
+// PF_W of any segment touching the page makes it writable. (No NX bit
+// without PAE, so PF_X can't be enforced; every present page is executable.)
+static uint32_t page_flags(const Elf32_Phdr* P, uint16_t phnum, uint32_t va) {
+    uint32_t flags = P_PRESENT | P_USER;
+    for (uint16_t j = 0; j < phnum; j++) {
+        if (P[j].p_type != PT_LOAD || P[j].p_memsz == 0) continue;
+        if (va < align_up(P[j].p_vaddr + P[j].p_memsz) && va + PAGE_SIZE > align_down(P[j].p_vaddr) &&
+            (P[j].p_flags & PF_W)) {
+            flags |= P_RW;
+        }
     }
-    // 32-bit little endian only
-    if (eh.e_ident[4] != 1 || eh.e_ident[5] != 1) {
-        vfs_close(fd);
-        return -1;
+    return flags;
+}
+
+// Give page 'va' its bytes from segment S: fresh pages get a frame and have
+// everything outside the file range zeroed; pages another segment already
+// mapped only get this segment's file bytes and bss.
+static int load_page(page_directory_t dir, const Elf32_Phdr* S, const elf_src_t* src,
+                     uint32_t va, uint32_t flags) {
+    uint32_t file_lo = max_u32(va, S->p_vaddr);
+    uint32_t file_hi = min_u32(va + PAGE_SIZE, S->p_vaddr + S->p_filesz);
+    if (file_hi < file_lo) file_hi = file_lo;
+
+    if (!paging_translate_in(dir, va)) {
+        if (paging_alloc_map_in(dir, va, flags) < 0) return -1;
+        if (paging_memset_in_dir(dir, va, 0, file_lo - va) < 0) return -1;
+        if (paging_memset_in_dir(dir, file_hi, 0, va + PAGE_SIZE - file_hi) < 0) return -1;
+    } else {
+        uint32_t bss_lo = max_u32(file_hi, S->p_vaddr + S->p_filesz);
+        uint32_t bss_hi = min_u32(va + PAGE_SIZE, S->p_vaddr + S->p_memsz);
+        if (bss_lo < bss_hi && paging_memset_in_dir(dir, bss_lo, 0, bss_hi - bss_lo) < 0) return -1;
     }
 
-    // You likely don't have vfs_seek -> easiest: read whole file into memory first.
-    // For now, implement a simple "slurp file" by reading in chunks until EOF.
-    // We'll do a fixed max to keep it minimal.
-    const uint32_t MAX_ELF = 512 * 1024;
-    uint8_t* img = (uint8_t*)kmalloc(MAX_ELF);
-    if (!img) { vfs_close(fd); return -1; }
-
-    // Copy header already read
-    for (uint32_t i = 0; i < sizeof(eh); i++) img[i] = ((uint8_t*)&eh)[i];
-
-    uint32_t off = sizeof(eh);
-    while (off < MAX_ELF) {
-        int r = vfs_read(fd, img + off, MAX_ELF - off);
-        if (r <= 0) break;
-        off += (uint32_t)r;
+    if (file_lo < file_hi) {
+        uint32_t off = S->p_offset + (file_lo - S->p_vaddr);
+        if (copy_file(dir, src, file_lo, off, file_hi - file_lo) < 0) return -1;
     }
-    vfs_close(fd);
+    return 0;
+}
 
-    Elf32_Ehdr* E = (Elf32_Ehdr*)img;
-    Elf32_Phdr* P = (Elf32_Phdr*)(img + E->e_phoff);
+// Map PT_LOAD segments + stack into 'dir'. Read-only pages come from the exec
+// cache when there is an entry (shared, never copied); the rest get fresh frames.
+static int map_image(page_directory_t dir, uint32_t entry, const Elf32_Phdr* P, uint16_t phnum,
+                     const elf_src_t* src, const elf_cache_entry_t* ce, user_image_t* out) {
+    uint32_t shared = 0, copied = 0;
 
-    // Map & load PT_LOAD segments
-    for (uint16_t i = 0; i < E->e_phnum; i++) {
+    for (uint16_t i = 0; i < phnum; i++) {
         if (P[i].p_type != PT_LOAD) continue;
+        if (P[i].p_memsz == 0) continue;
 
         uint32_t seg_start = align_down(P[i].p_vaddr);
         uint32_t seg_end   = align_up(P[i].p_vaddr + P[i].p_memsz);
 
-        // map pages
-        for (uint32_t va = seg_start; va < seg_end; va += 0x1000) {
-            if (paging_alloc_map_in(dir, va, P_PRESENT | P_RW | P_USER) < 0) {
-                kfree(img);
-                return -1;
+        for (uint32_t va = seg_start; va < seg_end; va += PAGE_SIZE) {
+            uint32_t frame = elf_cache_frame(ce, i, va);
+            if (frame) {
+                if (paging_map_in(dir, va, frame, P_PRESENT | P_USER | P_SHARED) < 0) return -1;
+                shared++;
+                continue;
             }
+            if (load_page(dir, &P[i], src, va, page_flags(P, phnum, va)) < 0) return -1;
+            copied++;
+        }
+    }
+
+    for (uint32_t i = 1; i <= UVM_STACK_PAGES; i++) {
+        uint32_t va = UVM_STACK_TOP - i * PAGE_SIZE;
+        if (paging_alloc_map_in(dir, va, P_PRESENT | P_RW | P_USER) < 0 ||
+            paging_memset_in_dir(dir, va, 0, PAGE_SIZE) < 0) {
+            return -1;
         }
+    }
+
+    out->entry = entry;
+    out->user_stack_top = UVM_STACK_TOP;
+    out->frames = shared + copied + UVM_STACK_PAGES;
+    out->cache = ce;
 
-        // copy file bytes
-        uint8_t* dst = (uint8_t*)(uintptr_t)P[i].p_vaddr;
-        uint8_t* src = img + P[i].p_offset;
+    printf("[elf] entry=%x user_stack_top=%x pages=%u shared=%u copied=%u%s\n",
+       out->entry, out->user_stack_top, (unsigned)UVM_STACK_PAGES, shared, copied,
+       ce ? " (cached)" : "");
+    return 0;
+}
 
-        for (uint32_t b = 0; b < P[i].p_filesz; b++) dst[b] = src[b];
+static int load_headers(int fd, uint32_t file_sz, Elf32_Ehdr* eh, Elf32_Phdr* P) {
+    if (pread_all(fd, 0, eh, sizeof(*eh)) < 0) return -1;
 
-        // zero bss
-        for (uint32_t b = P[i].p_filesz; b < P[i].p_memsz; b++) dst[b] = 0;
+    if (eh->e_ident[0] != 0x7F || eh->e_ident[1] != 'E' ||
+        eh->e_ident[2] != 'L'  || eh->e_ident[3] != 'F') {
+        return -1;
     }
+    if (eh->e_ident[4] != 1 || eh->e_ident[5] != 1) return -1; // ELF32, little-endian
+    if (eh->e_phentsize != sizeof(Elf32_Phdr) || eh->e_phnum > ELF_MAX_PH) return -1;
+
+    uint32_t ph_bytes = (uint32_t)eh->e_phnum * sizeof(Elf32_Phdr);
+    if (eh->e_phoff > file_sz || ph_bytes > file_sz - eh->e_phoff) return -1;
+    if (pread_all(fd, eh->e_phoff, P, ph_bytes) < 0) return -1;
 
-    // Map user stack (wrong)
-    // map N-page user stack (user RW)
-    for (int i = 1; i <= USER_STACK_PAGES; i++) {
-        uint32_t va = USER_STACK_TOP - (uint32_t)i * PAGE_SIZE;
-        if (paging_alloc_map_in(dir, va, P_PRESENT | P_RW | P_USER) < 0) {
-            kfree(img);
+    for (uint16_t i = 0; i < eh->e_phnum; i++) {
+        if (P[i].p_type != PT_LOAD) continue;
+        if (P[i].p_memsz == 0) continue;
+
+        // file bounds for this segment, no wrap
+        if (P[i].p_offset > file_sz || P[i].p_filesz > file_sz - P[i].p_offset ||
+            P[i].p_filesz > P[i].p_memsz) {
+            return -1;
+        }
+        // memory: inside the image window, the only part of user space
+        // nothing else is fixed in (stack, rings, time page, kernel fixmap
+        // and the identity map all lie outside it). Nothing is mapped yet.
+        if (P[i].p_vaddr < UVM_IMAGE_BASE || P[i].p_vaddr >= UVM_IMAGE_END ||
+            P[i].p_memsz > UVM_IMAGE_END - P[i].p_vaddr) {
             return -1;
         }
     }
+    if (eh->e_entry < UVM_IMAGE_BASE || eh->e_entry >= UVM_IMAGE_END) return -1;
+    return 0;
+}
 
-    out->entry = E->e_entry;
-    out->user_stack_top = USER_STACK_TOP; 
+int elf_load_from_vfs(const char* path, page_directory_t dir, user_image_t* out) {
+    vfs_stat_t st;
+    if (vfs_stat(path, &st) < 0 || st.is_dir) return -1;
 
-    kfree(img);
-    return 0;
+    int fd = vfs_open(path);
+    if (fd < 0) return -1;
+
+    // Resident file (initrd): copy from the bytes in place
+    elf_src_t src = { fd, (const uint8_t*)vfs_data(fd, 0) };
+    int rc = -1;
+
+    // Same initrd file exec'd before: headers already parsed and validated
+    const elf_cache_entry_t* ce = src.img ? elf_cache_lookup(path, src.img) : 0;
+    if (ce) {
+        rc = map_image(dir, ce->entry, ce->ph, ce->phnum, &src, ce, out);
+    } else {
+        Elf32_Ehdr eh;
+        Elf32_Phdr P[ELF_MAX_PH];
+        if (load_headers(fd, st.size, &eh, P) == 0) {
+            if (src.img) ce = elf_cache_insert(path, src.img, &eh, P);
+            rc = map_image(dir, eh.e_entry, P, eh.e_phnum, &src, ce, out);
+        }
+    }
+
+    // the frames may already be mapped into 'dir'; its teardown skips them
+    if (rc < 0) elf_cache_put(ce);
+    vfs_close(fd);
+    return rc;
 }
@@ -0,0 +1,142 @@
+#include <stdint.h>
+#include <string.h>
+#include <kernel/elf_cache.h>
+#include <arch/i386/cpu.h>
+#include <arch/i386/paging.h>
+#include <arch/i386/pmm.h>
+
+// Callers hold the BKL (exec, process teardown).
+static elf_cache_entry_t g_cache[ELF_CACHE_SLOTS];
+static uint32_t g_used = 0;
+static uint32_t g_clock = 0;
+
+#define FRAME_OWNED 1u     // copied into a frame of our own, not the image's
+
+static uint32_t align_down(uint32_t x) { return x & 0xFFFFF000u; }
+static uint32_t align_up(uint32_t x)   { return (x + 0xFFFu) & 0xFFFFF000u; }
+
+const elf_cache_entry_t* elf_cache_lookup(const char* path, const void* data) {
+    for (uint32_t i = 0; i < g_used; i++) {
+        elf_cache_entry_t* e = &g_cache[i];
+        if (e->data == data && strcmp(e->path, path) == 0) {
+            e->hits++;
+            e->users++;
+            e->last_use = ++g_clock;
+            return e;
+        }
+    }
+    return 0;
+}
+
+void elf_cache_put(const elf_cache_entry_t* ce) {
+    elf_cache_entry_t* e = (elf_cache_entry_t*)ce;
+    if (e && e->users) e->users--;
+}
+
+// give back the frames we copied; image frames belong to the initrd
+static void entry_release(elf_cache_entry_t* e) {
+    for (uint32_t k = 0; k < ELF_CACHE_MAX_PAGES; k++) {
+        if (e->frames[k] & FRAME_OWNED) pmm_free_frame(e->frames[k] & 0xFFFFF000u);
+    }
+    memset(e, 0, sizeof(*e));
+}
+
+// A slot for a new entry: a free one, else the least recently used idle one
+static elf_cache_entry_t* take_slot(void) {
+    if (g_used < ELF_CACHE_SLOTS) return &g_cache[g_used++];
+
+    elf_cache_entry_t* victim = 0;
+    for (uint32_t i = 0; i < ELF_CACHE_SLOTS; i++) {
+        elf_cache_entry_t* e = &g_cache[i];
+        if (e->users) continue;
+        if (!victim || e->last_use < victim->last_use) victim = e;
+    }
+    if (victim) entry_release(victim);
+    return victim;
+}
+
+// Page belongs to this read-only segment alone (a page shared with another
+// segment has to be private, it may need to be writable).
+static int page_exclusive(const Elf32_Phdr* ph, uint16_t phnum, uint16_t i, uint32_t va) {
+    for (uint16_t j = 0; j < phnum; j++) {
+        if (j == i || ph[j].p_type != PT_LOAD || ph[j].p_memsz == 0) continue;
+        uint32_t s0 = align_down(ph[j].p_vaddr);
+        uint32_t s1 = align_up(ph[j].p_vaddr + ph[j].p_memsz);
+        if (va < s1 && va + PAGE_SIZE > s0) return 0;
+    }
+    return 1;
+}
+
+// Frame holding page 'va' of segment S: the image's own frame when the page
+// is fully file-backed and page-aligned in memory, otherwise a copy made once.
+// Copies come back tagged FRAME_OWNED.
+static uint32_t prepare_frame(const Elf32_Phdr* S, const uint8_t* img, uint32_t va) {
+    if (va >= S->p_vaddr && va + PAGE_SIZE <= S->p_vaddr + S->p_filesz) {
+        uint32_t src = (uint32_t)(img + S->p_offset + (va - S->p_vaddr));
+        if ((src & 0xFFFu) == 0) {
+            uint32_t phys = paging_translate_in(paging_kernel_directory(), src);
+            if (phys) return phys;
+        }
+    }
+
+    uint32_t frame = (uint32_t)pmm_alloc_frame();
+    if (!frame) return 0;
+
+    uint32_t lo = va > S->p_vaddr ? va : S->p_vaddr;
+    uint32_t hi = S->p_vaddr + S->p_filesz;
+    if (hi > va + PAGE_SIZE) hi = va + PAGE_SIZE;
+
+    uint32_t f = irq_save();
+    uint8_t* p = (uint8_t*)paging_kmap(frame);
+    memset(p, 0, PAGE_SIZE);
+    if (lo < hi) memcpy(p + (lo - va), img + S->p_offset + (lo - S->p_vaddr), hi - lo);
+    paging_kunmap(p);
+    irq_restore(f);
+    return frame | FRAME_OWNED;
+}
+
+const elf_cache_entry_t* elf_cache_insert(const char* path, const void* data,
+                                          const Elf32_Ehdr* eh, const Elf32_Phdr* ph) {
+    if (eh->e_phnum > ELF_CACHE_MAX_PH) return 0;
+    if (strlen(path) >= sizeof(g_cache[0].path)) return 0;
+
+    elf_cache_entry_t* e = take_slot();
+    if (!e) return 0;
+
+    memset(e, 0, sizeof(*e));
+    strcpy(e->path, path);
+    e->data  = data;
+    e->entry = eh->e_entry;
+    e->phnum = eh->e_phnum;
+    memcpy(e->ph, ph, eh->e_phnum * sizeof(Elf32_Phdr));
+
+    uint32_t next = 0;
+    for (uint16_t i = 0; i < e->phnum; i++) {
+        const Elf32_Phdr* S = &e->ph[i];
+        if (S->p_type != PT_LOAD || S->p_memsz == 0 || (S->p_flags & PF_W)) continue;
+
+        uint32_t start = align_down(S->p_vaddr);
+        uint32_t n = (align_up(S->p_vaddr + S->p_memsz) - start) / PAGE_SIZE;
+        if (n > ELF_CACHE_MAX_PAGES - next) continue;   // too big, load privately
+
+        e->first[i] = (uint16_t)next;
+        e->count[i] = (uint16_t)n;
+        for (uint32_t k = 0; k < n; k++) {
+            uint32_t va = start + k * PAGE_SIZE;
+            e->frames[next + k] = page_exclusive(e->ph, e->phnum, i, va)
+                                ? prepare_frame(S, (const uint8_t*)data, va) : 0;
+        }
+        next += n;
+    }
+
+    e->users = 1;
+    e->last_use = ++g_clock;
+    return e;
+}
+
+uint32_t elf_cache_frame(const elf_cache_entry_t* e, uint16_t seg, uint32_t va) {
+    if (!e || seg >= e->phnum || !e->count[seg]) return 0;
+    uint32_t k = (va - align_down(e->ph[seg].p_vaddr)) / PAGE_SIZE;
+    if (k >= e->count[seg]) return 0;
+    return e->frames[e->first[seg] + k] & 0xFFFFF000u;
+}
@@ -117,11 +117,13 @@ typedef struct {
 static int initrd_read(vnode_t* vn, uint32_t off, void* buf, uint32_t len);
 static int initrd_readdir(vnode_t* vn, uint32_t index, char* name_out, uint32_t name_max);
 static vnode_t* initrd_lookup(vnode_t* dir, const char* name);
+static const void* initrd_data(vnode_t* vn);
 
 static const vnode_ops_t g_ops = {
     .read = initrd_read,
     .readdir = initrd_readdir,
-    .lookup = initrd_lookup
+    .lookup = initrd_lookup,
+    .data = initrd_data
 };
 
 static vnode_t* g_root = 0;
@@ -183,6 +185,12 @@ static int initrd_read(vnode_t* vn, uint32_t off, void* buf, uint32_t len) {
     return (int)n;
 }
 
+// file bytes sit right after their header in the tar image
+static const void* initrd_data(vnode_t* vn) {
+    if (!vn || vn->is_dir) return 0;
+    return (const uint8_t*)vn->fs_data + 512;
+}
+
 // directory listing: return immediate children only
 static int initrd_readdir(vnode_t* vn, uint32_t index, char* name_out, uint32_t name_max) {
     if (!vn || !vn->is_dir) return -1;
@@ -0,0 +1,190 @@
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <kernel/vfs.h>
+#include <arch/i386/cpu.h>
+#include <arch/i386/paging.h>
+#include <arch/i386/uaccess.h>
+#include <arch/i386/syscall.h>
+#include <arch/i386/ufd.h>
+#include <arch/i386/proc.h>
+
+#define UFD_FIRST 3
+#define UFD_NONE  (-1)
+
+// bounce buffer for files that aren't resident, on the caller's stack: the
+// fs may sleep, and other readers (other CPUs, the uring poll) can come in
+#define UFD_BOUNCE 512u
+
+void ufd_init(ufd_table_t* t) {
+    for (int i = 0; i < UFD_MAX; i++) t->vfd[i] = UFD_NONE;
+}
+
+void ufd_close_all(ufd_table_t* t) {
+    for (int i = UFD_FIRST; i < UFD_MAX; i++) {
+        if (t->vfd[i] != UFD_NONE) vfs_close(t->vfd[i]);
+        t->vfd[i] = UFD_NONE;
+    }
+}
+
+// the calling process's table; kernel threads have none
+static int* cur_fds(void) {
+    proc_t* p = proc_current();
+    return p ? p->fds.vfd : 0;
+}
+
+int ufd_vfs(int32_t fd) {
+    int* fds = cur_fds();
+    if (!fds || fd < UFD_FIRST || fd >= UFD_MAX) return -1;
+    return fds[fd];
+}
+
+int32_t ufd_open(const char* upath) {
+    char path[128];
+    int n = strncpy_from_user(path, upath, sizeof(path));
+    if (n < 0 || n >= (int)sizeof(path)) return -1;
+
+    int* fds = cur_fds();
+    if (!fds) return -1;
+
+    int fd = UFD_FIRST;
+    while (fd < UFD_MAX && fds[fd] != UFD_NONE) fd++;
+    if (fd == UFD_MAX) return -1;
+
+    int vfd = vfs_open(path);
+    if (vfd < 0) return -1;
+    fds[fd] = vfd;
+    return fd;
+}
+
+int32_t ufd_close(int32_t fd) {
+    int vfd = ufd_vfs(fd);
+    if (vfd < 0) return -1;
+    vfs_close(vfd);
+    cur_fds()[fd] = UFD_NONE;
+    return 0;
+}
+
+// Resident file bytes -> user memory. The source is reached through the
+// kernel directory (like uvm's copy_file_bytes): with ours loaded, a user
+// window could hide its identity address. Returns bytes copied.
+static uint32_t copy_resident(void* ubuf, const uint8_t* src, uint32_t len) {
+    page_directory_t kdir = paging_kernel_directory();
+    uint32_t done = 0;
+    while (done < len) {
+        uint32_t s = (uint32_t)(src + done);
+        uint32_t n = PAGE_SIZE - (s & 0xFFFu);
+        if (n > len - done) n = len - done;
+
+        // a fault in the copy (demand paging) nests its own kmap
+        uint32_t f = irq_save();
+        uint8_t* p = (uint8_t*)paging_kmap(paging_translate_in(kdir, s) & 0xFFFFF000u);
+        uint32_t c = copy_to_user_partial((uint8_t*)ubuf + done, p + (s & 0xFFFu), n);
+        paging_kunmap(p);
+        irq_restore(f);
+
+        done += c;
+        if (c < n) break;
+    }
+    return done;
+}
+
+// [off, off+len) of the file into user memory. Resident files are copied
+// straight from their bytes; others go through the bounce buffer. A copy
+// cut short by a bad page still reports what landed (-1 if nothing did).
+static int32_t read_at(int vfd, void* ubuf, uint32_t len, uint32_t off) {
+    if (!access_ok(ubuf, len)) return -1;
+
+    uint32_t size = 0;
+    const uint8_t* data = (const uint8_t*)vfs_data(vfd, &size);
+    if (data) {
+        if (off >= size) return 0;
+        if (len > size - off) len = size - off;
+        if (!len) return 0;
+        uint32_t done = copy_resident(ubuf, data + off, len);
+        return done ? (int32_t)done : -1;
+    }
+
+    uint8_t bounce[UFD_BOUNCE];
+    uint32_t got = 0;
+    while (got < len) {
+        uint32_t n = len - got;
+        if (n > sizeof(bounce)) n = sizeof(bounce);
+
+        int r = vfs_pread(vfd, off + got, bounce, n);
+        if (r < 0) return got ? (int32_t)got : -1;
+        if (r == 0) break;
+        uint32_t c = copy_to_user_partial((uint8_t*)ubuf + got, bounce, (uint32_t)r);
+        got += c;
+        if (c < (uint32_t)r) return got ? (int32_t)got : -1;
+        if ((uint32_t)r < n) break;
+    }
+    return (int32_t)got;
+}
+
+int32_t ufd_pread(int32_t fd, void* ubuf, uint32_t len, uint32_t off) {
+    int vfd = ufd_vfs(fd);
+    if (vfd < 0) return -1;
+    return read_at(vfd, ubuf, len, off);
+}
+
+int32_t ufd_read(int32_t fd, void* ubuf, uint32_t len) {
+    int vfd = ufd_vfs(fd);
+    if (vfd < 0) return -1;
+
+    // the offset is ours for the whole read: a concurrent read on the
+    // same file waits instead of reading the same bytes
+    int32_t pos = vfs_file_claim(vfd);
+    if (pos < 0) return -1;
+    int32_t r = read_at(vfd, ubuf, len, (uint32_t)pos);
+    vfs_file_release(vfd, r > 0 ? (uint32_t)r : 0);
+    return r;
+}
+
+// open(path, flags)
+uint32_t sys_open(regs_t* r) {
+    if ((r->ecx & 3) != O_RDONLY) return (uint32_t)-1;
+    return (uint32_t)ufd_open((const char*)r->ebx);
+}
+
+uint32_t sys_close(regs_t* r) {
+    return (uint32_t)ufd_close((int32_t)r->ebx);
+}
+
+// read(fd, buf, len)
+uint32_t sys_read(regs_t* r) {
+    return (uint32_t)ufd_read((int32_t)r->ebx, (void*)r->ecx, r->edx);
+}
+
+// pread(fd, buf, len, off)
+uint32_t sys_pread(regs_t* r) {
+    return (uint32_t)ufd_pread((int32_t)r->ebx, (void*)r->ecx, r->edx, r->esi);
+}
+
+// lseek(fd, off, whence) -> new offset
+uint32_t sys_lseek(regs_t* r) {
+    int vfd = ufd_vfs((int32_t)r->ebx);
+    if (vfd < 0) return (uint32_t)-1;
+    return (uint32_t)vfs_lseek(vfd, (int32_t)r->ecx, (int)r->edx);
+}
+
+// fstat(fd, struct stat*)
+uint32_t sys_fstat(regs_t* r) {
+    int32_t fd = (int32_t)r->ebx;
+    struct stat st;
+    memset(&st, 0, sizeof(st));
+
+    if (fd >= 0 && fd < UFD_FIRST) {
+        st.st_mode = S_IFCHR;
+    } else {
+        vfs_stat_t vs;
+        int vfd = ufd_vfs(fd);
+        if (vfd < 0 || vfs_fstat(vfd, &vs) < 0) return (uint32_t)-1;
+        st.st_mode = vs.is_dir ? S_IFDIR : S_IFREG;
+        st.st_size = vs.size;
+    }
+
+    if (copy_to_user((void*)r->ecx, &st, sizeof(st)) < 0) return (uint32_t)-1;
+    return 0;
+}
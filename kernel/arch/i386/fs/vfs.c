@@ -1,15 +1,64 @@
 #include <kernel/vfs.h>
 #include <string.h>
 #include <stdio.h>
+#include <arch/i386/spinlock.h>
+#include <arch/i386/wait.h>
 
 #define MAX_FD 32
 
 static vnode_t* g_root = 0;
 static file_t g_fds[MAX_FD];
+// Slot alloc/free and offsets. The vnode reads themselves run outside it:
+// they may copy into user memory and take a page fault, or sleep. A read
+// that moves the offset marks its file busy instead, for the whole read,
+// and others wanting that offset sleep on g_fds_wait.
+static spinlock_t g_fds_lock = SPINLOCK_INIT;
+static wait_queue_t g_fds_wait = WAIT_QUEUE_INIT;
+
+// Copy of an open fd's file_t, or -1
+static int fd_get(int fd, file_t* out) {
+    if (fd < 0 || fd >= MAX_FD) return -1;
+    uint32_t f = spin_lock_irqsave(&g_fds_lock);
+    int ok = g_fds[fd].used;
+    if (ok) *out = g_fds[fd];
+    spin_unlock_irqrestore(&g_fds_lock, f);
+    return ok ? 0 : -1;
+}
+
+// 1 and the offset in *off if we now own it, 0 if busy, -1 if not open
+static int file_try_claim(int fd, uint32_t* off) {
+    uint32_t f = spin_lock_irqsave(&g_fds_lock);
+    file_t* fp = &g_fds[fd];
+    int r = !fp->used ? -1 : fp->busy ? 0 : 1;
+    if (r > 0) {
+        fp->busy = 1;
+        *off = fp->off;
+    }
+    spin_unlock_irqrestore(&g_fds_lock, f);
+    return r;
+}
+
+int32_t vfs_file_claim(int fd) {
+    if (fd < 0 || fd >= MAX_FD) return -1;
+    uint32_t off = 0;
+    int r;
+    wait_event(&g_fds_wait, (r = file_try_claim(fd, &off)) != 0);
+    return r < 0 ? -1 : (int32_t)off;
+}
+
+void vfs_file_release(int fd, uint32_t advance) {
+    uint32_t f = spin_lock_irqsave(&g_fds_lock);
+    g_fds[fd].off += advance;
+    g_fds[fd].busy = 0;
+    spin_unlock_irqrestore(&g_fds_lock, f);
+    wake_up_all(&g_fds_wait);
+}
 
 void vfs_init(vnode_t* root) {
+    spin_init(&g_fds_lock, "vfs fds");
+    wait_queue_init(&g_fds_wait, "vfs fds wait");
     g_root = root;
-    for (int i = 0; i < MAX_FD; i++) g_fds[i].used = 0;
+    for (int i = 0; i < MAX_FD; i++) g_fds[i].used = g_fds[i].busy = 0;
 }
 
 static vnode_t* vfs_resolve(const char* path) {
@@ -45,30 +94,94 @@ int vfs_open(const char* path) {
     if (!vn || vn->is_dir) return -1;
     if (!vn->ops || !vn->ops->read) return -1;
 
+    uint32_t f = spin_lock_irqsave(&g_fds_lock);
     for (int fd = 0; fd < MAX_FD; fd++) {
-        if (!g_fds[fd].used) {
+        // a slot closed mid-read stays busy until that read lets go
+        if (!g_fds[fd].used && !g_fds[fd].busy) {
             g_fds[fd].used = 1;
             g_fds[fd].vn = vn;
             g_fds[fd].off = 0;
+            spin_unlock_irqrestore(&g_fds_lock, f);
             return fd;
         }
     }
+    spin_unlock_irqrestore(&g_fds_lock, f);
     return -1;
 }
 
+// Read and offset update are one step: concurrent readers of a shared fd
+// get consecutive ranges, never the same bytes twice.
 int vfs_read(int fd, void* buf, uint32_t len) {
+    int32_t off = vfs_file_claim(fd);
+    if (off < 0) return -1;
+    // closed since, maybe, but not reused while we hold it
+    file_t file;
+    if (fd_get(fd, &file) < 0) {
+        vfs_file_release(fd, 0);
+        return -1;
+    }
+    int r = file.vn->ops->read(file.vn, (uint32_t)off, buf, len);
+    vfs_file_release(fd, r > 0 ? (uint32_t)r : 0);
+    return r;
+}
+
+int vfs_pread(int fd, uint32_t off, void* buf, uint32_t len) {
+    file_t file;
+    if (fd_get(fd, &file) < 0) return -1;
+
+    return file.vn->ops->read(file.vn, off, buf, len);
+}
+
+const void* vfs_data(int fd, uint32_t* size_out) {
+    file_t file;
+    if (fd_get(fd, &file) < 0) return 0;
+
+    vnode_t* vn = file.vn;
+    if (!vn->ops->data) return 0;
+    if (size_out) *size_out = vn->size;
+    return vn->ops->data(vn);
+}
+
+int32_t vfs_lseek(int fd, int32_t off, int whence) {
     if (fd < 0 || fd >= MAX_FD) return -1;
-    if (!g_fds[fd].used) return -1;
+    // not while a read owns the offset; it would add to whatever we set
+    if (vfs_file_claim(fd) < 0) return -1;
 
+    uint32_t fl = spin_lock_irqsave(&g_fds_lock);
     file_t* f = &g_fds[fd];
-    int r = f->vn->ops->read(f->vn, f->off, buf, len);
-    if (r > 0) f->off += (uint32_t)r;
+    int32_t base = 0;
+    int ok = f->used;
+    if (ok) {
+        switch (whence) {
+        case VFS_SEEK_SET: base = 0; break;
+        case VFS_SEEK_CUR: base = (int32_t)f->off; break;
+        case VFS_SEEK_END: base = (int32_t)f->vn->size; break;
+        default: ok = 0; break;
+        }
+    }
+    if (ok && (off < 0 ? base + off < 0 : base + off < base)) ok = 0;
+    if (ok) f->off = (uint32_t)(base + off);
+    int32_t r = ok ? (int32_t)f->off : -1;
+    f->busy = 0;
+    spin_unlock_irqrestore(&g_fds_lock, fl);
+    wake_up_all(&g_fds_wait);
     return r;
 }
 
+int vfs_fstat(int fd, vfs_stat_t* st) {
+    file_t file;
+    if (!st || fd_get(fd, &file) < 0) return -1;
+
+    st->size   = file.vn->size;
+    st->is_dir = file.vn->is_dir ? 1 : 0;
+    return 0;
+}
+
 int vfs_close(int fd) {
     if (fd < 0 || fd >= MAX_FD) return -1;
+    uint32_t f = spin_lock_irqsave(&g_fds_lock);
     g_fds[fd].used = 0;
+    spin_unlock_irqrestore(&g_fds_lock, f);
     return 0;
 }
 
@@ -1,14 +1,16 @@
 // interrupts.c
 #include <arch/i386/gdt.h>
 #include <arch/i386/idt.h>
+#include <arch/i386/isr.h>
 #include <arch/i386/pic.h>
+#include <arch/i386/timer.h>
 
-void timer_init(unsigned hz);
 void keyboard_init(void);
 
 void interrupts_init(void) {
     gdt_init();
     idt_init();
+    irq_init();
 
     pic_remap(0x20, 0x28); // 32, 40
     // Unmask only timer(IRQ0) and keyboard(IRQ1) for now
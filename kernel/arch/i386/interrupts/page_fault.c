@@ -2,14 +2,15 @@
 #include <arch/i386/isr.h>   // for regs_t
 #include <stdio.h>
 #include <arch/i386/paging.h>
+#include <arch/i386/uaccess.h>
+#include <arch/i386/uvm.h>
+#include <arch/i386/proc.h>
 
 extern void vga_print(const char* s);
 extern void vga_print_hex(uint32_t x);
 
 extern volatile uint32_t dbg_iret_eip, dbg_iret_cs, dbg_iret_eflags, dbg_iret_esp, dbg_iret_ss;
 
-#define PF_TMP_PT_VA 0x00FF0000u  // must be in your kernel-mapped region (0..16MB)
-
 static inline uint32_t read_cr2(void) {
     uint32_t v;
     asm volatile("mov %%cr2, %0" : "=r"(v));
@@ -51,22 +52,34 @@ static void pf_walk(uint32_t cr2) {
 
     uint32_t pt_phys = pde & 0xFFFFF000u;
 
-    paging_map(PF_TMP_PT_VA, pt_phys, P_PRESENT | P_RW);
-    uint32_t* pt = (uint32_t*)PF_TMP_PT_VA;
-
+    uint32_t* pt = (uint32_t*)paging_kmap(pt_phys);
     uint32_t pte = pt[pti];
+    paging_kunmap(pt);
 
     vga_print("PF walk: pt_phys=");
     vga_print_hex(pt_phys);
     vga_print(" pte=");
     vga_print_hex(pte);
     vga_print("\n");
-
-    paging_unmap(PF_TMP_PT_VA);
 }
 
 void page_fault_handler(regs_t* r) {
     uint32_t cr2 = read_cr2();
+    proc_t* p = proc_current();
+    if (p) p->faults++;
+
+    // first touch of a heap/mmap page (from user, or from a uaccess copy)
+    if (uvm_fault(cr2, r->err_code)) return;
+
+    // kernel faulted inside copy_{from,to}_user: resume at the fixup
+    if ((r->cs & 3) == 0 && extable_fixup(r)) return;
+
+    // bad user access: kill the process, not the machine
+    if ((r->cs & 3) == 3 && proc_current()) {
+        printf("\n[pid %u] page fault at %x eip=%x err=%x, killed\n",
+               proc_current()->pid, cr2, r->eip, r->err_code);
+        proc_exit(-1);
+    }
 
     vga_print("\nPAGE FAULT: cr2=");
     vga_print_hex(cr2);
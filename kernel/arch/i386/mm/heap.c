@@ -1,5 +1,6 @@
 #include <kernel/heap.h>
 #include <arch/i386/pmm.h>
+#include <arch/i386/spinlock.h>
 
 extern void vga_print(const char* s);
 extern void vga_print_hex(uint32_t x);
@@ -13,7 +14,11 @@ static uintptr_t g_heap_brk   = 0;   // bump pointer
 
 static uintptr_t g_heap_mapped_end = 0; // end of backed pages
 
+// brk and mapped_end; taken before the pmm lock, never the other way round
+static spinlock_t g_heap_lock = SPINLOCK_INIT;
+
 void heap_init(uintptr_t heap_start, size_t heap_size) {
+    spin_init(&g_heap_lock, "heap");
     g_heap_start = ALIGN_UP(heap_start, 16);
     g_heap_end   = g_heap_start + heap_size;
     g_heap_brk   = g_heap_start;
@@ -52,13 +57,18 @@ static void heap_ensure_backed(uintptr_t new_brk) {
 
 void* kmalloc_aligned(size_t size, size_t align) {
     if (align < 16) align = 16;
+    uint32_t f = spin_lock_irqsave(&g_heap_lock);
     uintptr_t p = ALIGN_UP(g_heap_brk, align);
     uintptr_t new_brk = p + size;
 
-    if (new_brk > g_heap_end) return 0;
+    if (new_brk > g_heap_end) {
+        spin_unlock_irqrestore(&g_heap_lock, f);
+        return 0;
+    }
 
     heap_ensure_backed(new_brk);
     g_heap_brk = new_brk;
+    spin_unlock_irqrestore(&g_heap_lock, f);
     return (void*)p;
 }
 
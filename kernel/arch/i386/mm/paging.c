@@ -1,11 +1,25 @@
 #include <stdint.h>
+#include <string.h>
 #include <arch/i386/paging.h>
 #include <arch/i386/pmm.h>
+#include <arch/i386/pat.h>
+#include <arch/i386/cpu.h>
+#include <arch/i386/smp.h>
+
+#define CR0_WP 0x00010000u
 
 extern void vga_print(const char* s);
 extern void vga_print_hex(uint32_t x);
 
-static uint32_t* g_pd = 0;
+static uint32_t* g_pd[CPU_MAX];   // directory each CPU has loaded
+static uint32_t* g_kpd = 0;       // kernel directory (g_pd follows switches)
+static uint32_t  g_kmap_depth[CPU_MAX];  // kmap slots in use, per CPU
+
+// each CPU has its own KMAP_SLOTS pages, all inside the fixmap
+#define KMAP_CPU_VA(cpu) (KMAP_VA + (cpu) * KMAP_SLOTS * PAGE_SIZE)
+#if KMAP_VA + CPU_MAX * KMAP_SLOTS * PAGE_SIZE > FIXMAP_END
+#error "kmap slots for CPU_MAX CPUs don't fit in the fixmap"
+#endif
 
 static inline void write_cr3(uint32_t phys) {
     asm volatile("mov %0, %%cr3" :: "r"(phys) : "memory");
@@ -36,7 +50,8 @@ static uint32_t* alloc_table(void) {
 void paging_init_identity(void) {
     vga_print("paging: build tables\n");
 
-    g_pd = alloc_table();
+    g_kpd = alloc_table();
+    g_pd[cpu_id()] = g_kpd;
 
     // Identity-map 0..16MB => 4 page tables (PDE 0..3)
     for (uint32_t pde = 0; pde < KERNEL_PDE_END; pde++) {
@@ -45,23 +60,30 @@ void paging_init_identity(void) {
             uint32_t addr = (pde * 0x400000u) + (pte * PAGE_SIZE);
             pt[pte] = (addr & 0xFFFFF000u) | P_PRESENT | P_RW;
         }
-        g_pd[pde] = ((uint32_t)pt & 0xFFFFF000u) | P_PRESENT | P_RW;
+        g_kpd[pde] = ((uint32_t)pt & 0xFFFFF000u) | P_PRESENT | P_RW;
     }
 
     vga_print("paging: enable cr3=");
-    vga_print_hex((uint32_t)g_pd);
+    vga_print_hex((uint32_t)g_kpd);
     vga_print("\n");
 
-    write_cr3((uint32_t)g_pd);
+    write_cr3((uint32_t)g_kpd);
 
     uint32_t cr0 = read_cr0();
     cr0 |= 0x80000000u; // PG
+    cr0 |= CR0_WP;      // read-only user pages are read-only for us too
     write_cr0(cr0);
 
     vga_print("paging: enabled\n");
 }
 
 static inline uint32_t pde_index(uint32_t v) { return (v >> 22) & 0x3FF; }
+
+// Without PAT, PWT alone would mean write-through; don't hand that out as WC.
+static inline uint32_t pte_cache_flags(uint32_t flags) {
+    if ((flags & P_WC) && !pat_wc_supported()) flags &= ~P_WC;
+    return flags;
+}
 static inline uint32_t pte_index(uint32_t v) { return (v >> 12) & 0x3FF; }
 
 // Upgrade an existing PDE to be at least as permissive as needed for this mapping.
@@ -79,14 +101,15 @@ static inline void pde_upgrade(uint32_t* pd, uint32_t pdi, uint32_t need_flags)
     }
 }
 
-// Kernel current directory path (uses global g_pd)
+// Kernel current directory path (uses this CPU's g_pd)
 static uint32_t* get_or_alloc_pt(uint32_t vaddr, int make, uint32_t need_flags) {
+    uint32_t* pd = g_pd[cpu_id()];
     uint32_t pdi = pde_index(vaddr);
-    uint32_t pde = g_pd[pdi];
+    uint32_t pde = pd[pdi];
 
     if (pde & P_PRESENT) {
         // If caller needs user/rw, PDE must allow it too
-        pde_upgrade(g_pd, pdi, need_flags);
+        pde_upgrade(pd, pdi, need_flags);
         return (uint32_t*)(pde & 0xFFFFF000u); // identity-mapped PT
     }
 
@@ -98,7 +121,7 @@ static uint32_t* get_or_alloc_pt(uint32_t vaddr, int make, uint32_t need_flags)
     if (need_flags & P_RW)   pde_flags |= P_RW;
     if (need_flags & P_USER) pde_flags |= P_USER;
 
-    g_pd[pdi] = ((uint32_t)pt & 0xFFFFF000u) | pde_flags;
+    pd[pdi] = ((uint32_t)pt & 0xFFFFF000u) | pde_flags;
     return pt;
 }
 
@@ -110,11 +133,34 @@ int paging_map(uint32_t vaddr, uint32_t paddr, uint32_t flags) {
     uint32_t* pt = get_or_alloc_pt(vaddr, 1, flags);
     if (!pt) return -1;
 
-    pt[pte_index(vaddr)] = paddr | (flags | P_PRESENT);
+    pt[pte_index(vaddr)] = paddr | (pte_cache_flags(flags) | P_PRESENT);
     asm volatile("invlpg (%0)" :: "r"(vaddr) : "memory");
     return 0;
 }
 
+// Display memory may only be identity-mapped where nothing else lives: the
+// legacy VGA hole, or the shared kernel-high PDEs. Anywhere else it would
+// alias kernel RAM (identity map) or sit under user space in the kernel
+// directory only.
+#define VGA_HOLE_START 0x000A0000u
+#define VGA_HOLE_END   0x000C0000u
+#define KERNEL_HIGH_START (KERNEL_HIGH_PDE_START << 22)
+
+int paging_map_wc(uint32_t paddr, uint32_t len) {
+    if (!len) return -1;
+    uint32_t start = paddr & 0xFFFFF000u;
+    uint64_t end64 = ((uint64_t)paddr + len + 0xFFFu) & ~(uint64_t)0xFFFu;
+    int in_hole = start >= VGA_HOLE_START && end64 <= VGA_HOLE_END;
+    int in_high = start >= KERNEL_HIGH_START && end64 <= 0x100000000ull;
+    if (!in_hole && !in_high) return -1;
+
+    uint32_t end = (uint32_t)end64;     // 0 when the range ends at 4GB
+    for (uint32_t a = start; a != end; a += PAGE_SIZE) {
+        if (paging_map(a, a, P_PRESENT | P_RW | P_WC) < 0) return -1;
+    }
+    return 0;
+}
+
 int paging_unmap(uint32_t vaddr) {
     vaddr &= 0xFFFFF000u;
     uint32_t* pt = get_or_alloc_pt(vaddr, 0, 0);
@@ -130,7 +176,7 @@ uint32_t paging_translate(uint32_t vaddr) {
     uint32_t pdi = pde_index(vaddr);
     uint32_t pti = pte_index(vaddr);
 
-    uint32_t pde = g_pd[pdi];
+    uint32_t pde = g_pd[cpu_id()][pdi];
     if (!(pde & P_PRESENT)) return 0;
 
     uint32_t* pt = (uint32_t*)(pde & 0xFFFFF000u);
@@ -149,13 +195,13 @@ int paging_alloc_map(uint32_t vaddr, uint32_t flags) {
 
 page_directory_t paging_kernel_directory(void) {
     page_directory_t d;
-    d.pd_phys = (uint32_t*)g_pd;
-    d.pd_virt = (uint32_t*)g_pd; // identity-mapped for now
+    d.pd_phys = (uint32_t*)g_kpd;
+    d.pd_virt = (uint32_t*)g_kpd; // identity-mapped for now
     return d;
 }
 
 void paging_switch_directory(page_directory_t dir) {
-    g_pd = dir.pd_virt;
+    g_pd[cpu_id()] = dir.pd_virt;
     asm volatile("mov %0, %%cr3" :: "r"((uint32_t)dir.pd_phys) : "memory");
 }
 
@@ -164,6 +210,16 @@ static uint32_t* get_or_alloc_pt_in(page_directory_t dir, uint32_t vaddr, uint32
     uint32_t pde = dir.pd_virt[pdi];
 
     if (pde & P_PRESENT) {
+        // User page inside the identity map: the PT is still the kernel's
+        // (shared by every clone). Give this directory a private copy so the
+        // mapping doesn't leak into the kernel and other processes.
+        if ((flags & P_USER) && dir.pd_virt != g_kpd && pdi < KERNEL_PDE_END &&
+            (pde & 0xFFFFF000u) == (g_kpd[pdi] & 0xFFFFF000u)) {
+            uint32_t* pt = alloc_table();
+            memcpy(pt, (uint32_t*)(pde & 0xFFFFF000u), PAGE_SIZE);
+            dir.pd_virt[pdi] = ((uint32_t)pt & 0xFFFFF000u) | P_PRESENT | P_RW | P_USER;
+            return pt;
+        }
         if ((flags & P_USER) && !(pde & P_USER)) {
             dir.pd_virt[pdi] |= P_USER;
         }
@@ -189,27 +245,98 @@ int paging_map_in(page_directory_t dir, uint32_t vaddr, uint32_t paddr, uint32_t
     if (!pt) return -1;
 
     uint32_t pti = pte_index(vaddr);
-    pt[pti] = paddr | flags | P_PRESENT;
+    pt[pti] = paddr | pte_cache_flags(flags) | P_PRESENT;
 
     asm volatile("invlpg (%0)" :: "r"(vaddr) : "memory");
     return 0;
 }
 
+uint32_t paging_unmap_in(page_directory_t dir, uint32_t vaddr) {
+    vaddr &= 0xFFFFF000u;
+    uint32_t* pt = get_or_alloc_pt_in(dir, vaddr, 0, 0);
+    if (!pt) return 0;
+
+    // still the kernel's shared PT: nothing of this directory's lives here
+    uint32_t pdi = pde_index(vaddr);
+    if (dir.pd_virt != g_kpd && pdi < KERNEL_PDE_END &&
+        (dir.pd_virt[pdi] & 0xFFFFF000u) == (g_kpd[pdi] & 0xFFFFF000u)) {
+        return 0;
+    }
+
+    uint32_t pti = pte_index(vaddr);
+    uint32_t old = pt[pti];
+    pt[pti] = 0;
+    if (dir.pd_virt == g_pd[cpu_id()]) asm volatile("invlpg (%0)" :: "r"(vaddr) : "memory");
+    return old;
+}
+
 int paging_alloc_map_in(page_directory_t dir, uint32_t vaddr, uint32_t flags) {
     uint32_t p = (uint32_t)pmm_alloc_frame();
     if (!p) return -1;
     return paging_map_in(dir, vaddr, p, flags);
 }
 
-static void memcpy32(void* dst, const void* src, uint32_t n) {
-    uint8_t* d = (uint8_t*)dst;
-    const uint8_t* s = (const uint8_t*)src;
-    for (uint32_t i = 0; i < n; i++) d[i] = s[i];
+uint32_t paging_translate_in(page_directory_t dir, uint32_t vaddr) {
+    uint32_t pde = dir.pd_virt[pde_index(vaddr)];
+    if (!(pde & P_PRESENT)) return 0;
+
+    uint32_t* pt = (uint32_t*)(pde & 0xFFFFF000u);
+    uint32_t pte = pt[pte_index(vaddr)];
+    if (!(pte & P_PRESENT)) return 0;
+
+    return (pte & 0xFFFFF000u) | (vaddr & 0xFFF);
+}
+
+// IRQs are off across a kmap, so the CPU (and its slots) can't change under it
+void* paging_kmap(uint32_t paddr) {
+    uint32_t cpu = cpu_id();
+    if (g_kmap_depth[cpu] >= KMAP_SLOTS) {
+        vga_print("paging: kmap slots exhausted\n");
+        for(;;) asm volatile("cli; hlt");
+    }
+    uint32_t va = KMAP_CPU_VA(cpu) + g_kmap_depth[cpu]++ * PAGE_SIZE;
+    paging_map(va, paddr, P_PRESENT | P_RW);
+    return (void*)va;
+}
+
+void paging_kunmap(void* vaddr) {
+    (void)vaddr; // LIFO: always the top slot
+    uint32_t cpu = cpu_id();
+    g_kmap_depth[cpu]--;
+    paging_unmap(KMAP_CPU_VA(cpu) + g_kmap_depth[cpu] * PAGE_SIZE);
+}
+
+// Walk [vaddr, vaddr+len) in 'dir' one page at a time; src == 0 means memset.
+static int copy_in_dir(page_directory_t dir, uint32_t vaddr, const uint8_t* src,
+                       uint8_t val, uint32_t len) {
+    while (len) {
+        uint32_t off = vaddr & 0xFFFu;
+        uint32_t n = PAGE_SIZE - off;
+        if (n > len) n = len;
+
+        uint32_t phys = paging_translate_in(dir, vaddr);
+        if (!phys) return -1;
+
+        uint32_t f = irq_save();
+        uint8_t* dst = (uint8_t*)paging_kmap(phys & 0xFFFFF000u) + off;
+        if (src) memcpy(dst, src, n);
+        else     memset(dst, val, n);
+        paging_kunmap(dst);
+        irq_restore(f);
+
+        if (src) src += n;
+        vaddr += n;
+        len -= n;
+    }
+    return 0;
 }
 
-static void memset32(void* dst, uint8_t v, uint32_t n) {
-    uint8_t* d = (uint8_t*)dst;
-    for (uint32_t i = 0; i < n; i++) d[i] = v;
+int paging_copy_to_dir(page_directory_t dir, uint32_t vaddr, const void* src, uint32_t len) {
+    return copy_in_dir(dir, vaddr, (const uint8_t*)src, 0, len);
+}
+
+int paging_memset_in_dir(page_directory_t dir, uint32_t vaddr, uint8_t val, uint32_t len) {
+    return copy_in_dir(dir, vaddr, 0, val, len);
 }
 
 page_directory_t paging_clone_directory(page_directory_t src) {
@@ -219,12 +346,45 @@ page_directory_t paging_clone_directory(page_directory_t src) {
     for (uint32_t pdi = 0; pdi < KERNEL_PDE_END; pdi++) {
         out.pd_virt[pdi] = src.pd_virt[pdi];
     }
-    for (uint32_t pdi = KERNEL_PDE_END; pdi < 1024; pdi++) {
+    for (uint32_t pdi = KERNEL_PDE_END; pdi < KERNEL_HIGH_PDE_START; pdi++) {
         out.pd_virt[pdi] = 0;
     }
+    // kernel-only high mappings (framebuffer, MMIO) are shared as well
+    for (uint32_t pdi = KERNEL_HIGH_PDE_START; pdi < 1024; pdi++) {
+        out.pd_virt[pdi] = src.pd_virt[pdi];
+    }
     return out;
 }
 
+void paging_free_directory(page_directory_t dir) {
+    if (!dir.pd_virt || dir.pd_virt == g_kpd || dir.pd_virt == g_pd[cpu_id()]) return;
+
+    // high PDEs are the kernel's, shared with every directory
+    for (uint32_t pdi = 0; pdi < KERNEL_HIGH_PDE_START; pdi++) {
+        uint32_t pde = dir.pd_virt[pdi];
+        if (!(pde & P_PRESENT)) continue;
+        if (pdi < KERNEL_PDE_END && (pde & 0xFFFFF000u) == (g_kpd[pdi] & 0xFFFFF000u)) continue;
+
+        // private table: user pages are P_USER, the identity entries copied
+        // in from the kernel's table are not
+        uint32_t* pt = (uint32_t*)(pde & 0xFFFFF000u);
+        for (uint32_t pti = 0; pti < PTE_COUNT; pti++) {
+            uint32_t pte = pt[pti];
+            if ((pte & (P_PRESENT | P_USER)) == (P_PRESENT | P_USER) && !(pte & P_SHARED)) {
+                pmm_free_frame(pte & 0xFFFFF000u);
+            }
+        }
+        pmm_free_frame((uintptr_t)pt);
+    }
+    pmm_free_frame((uintptr_t)dir.pd_phys);
+}
+
 uint32_t* paging_current_pd_virt(void) {
-    return g_pd;   // g_pd stays static
+    return g_pd[cpu_id()];
+}
+
+void paging_init_cpu(void) {
+    g_pd[cpu_id()] = g_kpd;
+    // the trampoline only turns PG on
+    write_cr0(read_cr0() | CR0_WP);
 }
\ No newline at end of file
@@ -0,0 +1,51 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <arch/i386/cpu.h>
+#include <arch/i386/pat.h>
+
+// PAT memory types
+#define PAT_UC  0x00u
+#define PAT_WC  0x01u
+#define PAT_WT  0x04u
+#define PAT_WB  0x06u
+#define PAT_UCM 0x07u   // UC-
+
+static int g_pat_wc = 0;
+
+// IRQs off around the switch, caches flushed on both sides (SDM 11.12.4)
+static uint64_t pat_apply(void) {
+    // power-on default is WB,WT,UC-,UC repeated; swap entry 1 (WT) for WC so
+    // PTEs with only PWT set (see P_WC) become write-combining.
+    uint64_t pat = rdmsr(MSR_IA32_PAT);
+    pat &= ~(0xFFull << 8);
+    pat |= (uint64_t)PAT_WC << 8;
+
+    uint32_t f = irq_save();
+    __asm__ volatile ("wbinvd" ::: "memory");
+    wrmsr(MSR_IA32_PAT, pat);
+    // flush TLB so no stale memory types linger
+    __asm__ volatile ("mov %%cr3, %%eax; mov %%eax, %%cr3" ::: "eax", "memory");
+    __asm__ volatile ("wbinvd" ::: "memory");
+    irq_restore(f);
+    return pat;
+}
+
+void pat_init(void) {
+    if (!(cpuid_edx(1) & CPUID_EDX_PAT)) {
+        printf("pat: not supported, no write-combining\n");
+        return;
+    }
+
+    uint64_t pat = pat_apply();
+    g_pat_wc = 1;
+    printf("pat: %x:%x (entry 1 = WC)\n", (uint32_t)(pat >> 32), (uint32_t)pat);
+}
+
+// PAT is per CPU: every AP needs the same table or P_WC means WT there
+void pat_init_cpu(void) {
+    if (g_pat_wc) pat_apply();
+}
+
+int pat_wc_supported(void) {
+    return g_pat_wc;
+}
@@ -2,6 +2,11 @@
 #include <stddef.h>
 #include <arch/i386/multiboot_1.h>
 #include <arch/i386/pmm.h>
+#include <arch/i386/paging.h>
+#include <arch/i386/uvm.h>
+#include <arch/i386/spinlock.h>
+#include <sys/vtime.h>
+#include <sys/uring.h>
 #include <stdio.h>
 
 /* you likely already have these */
@@ -29,6 +34,7 @@ extern uint8_t __kernel_end;
 static uint8_t*  g_bitmap = 0;     /* bitmap lives in kernel .bss/.data region after end */
 static uint32_t  g_total_frames = 0;
 static uint32_t  g_free_frames  = 0;
+static spinlock_t g_pmm_lock = SPINLOCK_INIT;   /* bitmap + free count; IRQ context allocates too */
 
 static inline void bit_set(uint32_t idx) {
     g_bitmap[idx >> 3] |=  (uint8_t)(1u << (idx & 7));
@@ -102,6 +108,26 @@ static uintptr_t detect_max_phys(multiboot_info_t* mbi) {
     return (uintptr_t)max_end;
 }
 
+/* Boot-placed memory the kernel reaches by identity (its image, the bitmap,
+   multiboot modules) must stay out of the windows every process remaps:
+   with a process directory loaded those addresses show its pages instead. */
+static void check_not_remapped(uintptr_t start, uintptr_t len, const char* what) {
+    static const struct { uint32_t start, end; } win[] = {
+        { FIXMAP_START, FIXMAP_END },
+        { UVM_IMAGE_BASE, UVM_IMAGE_END },
+        { VTIME_VA, VTIME_VA + PAGE_SIZE },
+        { URING_VA, URING_VA + PAGE_SIZE },
+        { UVM_STACK_TOP - UVM_STACK_PAGES * PAGE_SIZE, UVM_STACK_TOP },
+    };
+    for (uint32_t i = 0; i < sizeof(win) / sizeof(win[0]); i++) {
+        if (start < win[i].end && start + len > win[i].start) {
+            printf("pmm: %s at %x+%x overlaps %x..%x\n", what, (uint32_t)start,
+                   (uint32_t)len, win[i].start, win[i].end);
+            panic_vga("pmm: boot memory overlaps a user window");
+        }
+    }
+}
+
 void pmm_init(uint32_t multiboot_magic, uintptr_t multiboot_info_phys) {
     if (multiboot_magic != MULTIBOOT1_MAGIC) {
         panic_vga("Bad multiboot magic");
@@ -116,6 +142,8 @@ void pmm_init(uint32_t multiboot_magic, uintptr_t multiboot_info_phys) {
         panic_vga("Multiboot missing mmap (flag 1<<6 not set)");
     }
 
+    spin_init(&g_pmm_lock, "pmm");
+
     uintptr_t max_phys = detect_max_phys(mbi);
     g_total_frames = (uint32_t)(ALIGN_UP(max_phys, FRAME_SIZE) / FRAME_SIZE);
 
@@ -157,14 +185,30 @@ void pmm_init(uint32_t multiboot_magic, uintptr_t multiboot_info_phys) {
 
     /* 3) bitmap storage itself */
     mark_used_range(bitmap_phys, bitmap_bytes);
-
-    /* 4) multiboot modules (e.g., initrd later) */
+    check_not_remapped((uintptr_t)&__kernel_start, bitmap_phys + bitmap_bytes - (uintptr_t)&__kernel_start,
+                       "kernel image + bitmap");
+
+    /* 4) fixmap window: those VAs get remapped, so their identity frames
+       must never be handed out */
+    mark_used_range(FIXMAP_START, FIXMAP_END - FIXMAP_START);
+
+    /* 4b) fixed user windows inside the identity map (ELF image, time page,
+       ring, stack): every process maps its own pages there, hiding those
+       identity frames whenever its directory is loaded. Page tables and
+       other frames the kernel reaches by identity can't live there. */
+    mark_used_range(UVM_IMAGE_BASE, UVM_IMAGE_END - UVM_IMAGE_BASE);
+    mark_used_range(VTIME_VA, PAGE_SIZE);
+    mark_used_range(URING_VA, PAGE_SIZE);
+    mark_used_range(UVM_STACK_TOP - UVM_STACK_PAGES * PAGE_SIZE, UVM_STACK_PAGES * PAGE_SIZE);
+
+    /* 5) multiboot modules (e.g., initrd later) */
     if (mbi->flags & MULTIBOOT1_INFO_MODS) {
         multiboot_module_t* mods = (multiboot_module_t*)(uintptr_t)mbi->mods_addr;
         for (uint32_t i = 0; i < mbi->mods_count; i++) {
             uintptr_t s = (uintptr_t)mods[i].mod_start;
             uintptr_t l = (uintptr_t)(mods[i].mod_end - mods[i].mod_start);
             mark_used_range(s, l);
+            check_not_remapped(s, l, "module");
         }
     }
 
@@ -173,14 +217,17 @@ void pmm_init(uint32_t multiboot_magic, uintptr_t multiboot_info_phys) {
 }
 
 uintptr_t pmm_alloc_frame(void) {
+    uint32_t fl = spin_lock_irqsave(&g_pmm_lock);
     /* simple first-fit scan */
     for (uint32_t f = 0; f < g_total_frames; f++) {
         if (!bit_test(f)) {
             bit_set(f);
             if (g_free_frames) g_free_frames--;
+            spin_unlock_irqrestore(&g_pmm_lock, fl);
             return (uintptr_t)f * FRAME_SIZE;
         }
     }
+    spin_unlock_irqrestore(&g_pmm_lock, fl);
     return 0; /* OOM */
 }
 
@@ -192,11 +239,13 @@ void pmm_free_frame(uintptr_t paddr) {
     if (f >= g_total_frames) {
         panic_vga("pmm_free_frame: out of range");
     }
+    uint32_t fl = spin_lock_irqsave(&g_pmm_lock);
     if (!bit_test(f)) {
         panic_vga("pmm_free_frame: double free");
     }
     bit_clear(f);
     g_free_frames++;
+    spin_unlock_irqrestore(&g_pmm_lock, fl);
 }
 
 uint32_t pmm_total_frames(void) { return g_total_frames; }
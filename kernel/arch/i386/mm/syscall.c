@@ -1,31 +1,101 @@
 #include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <kernel/tty.h>
 #include <arch/i386/isr.h>
+#include <arch/i386/cpu.h>
+#include <arch/i386/uaccess.h>
+#include <arch/i386/syscall.h>
+#include <arch/i386/proc.h>
 
-extern int putchar(int);
+typedef uint32_t (*syscall_fn)(regs_t* r);
 
-static int sys_write(uint32_t fd, const char* buf, uint32_t len) {
-    (void)fd; // for now ignore, treat as stdout
-    int wrote = 0;
-    for (uint32_t i = 0; i < len; i++) {
-        putchar((unsigned char)buf[i]);
-        wrote++;
+uint32_t sys_putchar(regs_t* r) {
+    putchar((char)(r->ebx & 0xFF));
+    return 0;
+}
+
+// exit(code): doesn't come back, the process and its thread are gone
+uint32_t sys_exit(regs_t* r) {
+    proc_exit((int32_t)r->ebx);
+}
+
+// write(fd, buf, len): stdout/stderr only. Bytes go to the console in
+// kbuf-sized runs, one terminal_write each, not a putchar per byte.
+int32_t ksys_write(uint32_t fd, const char* ubuf, uint32_t len) {
+    if (fd != 1 && fd != 2) return -1;
+    if (!access_ok(ubuf, len)) return -1;
+
+    char kbuf[256];
+    uint32_t wrote = 0;
+    while (wrote < len) {
+        uint32_t n = len - wrote;
+        if (n > sizeof(kbuf)) n = sizeof(kbuf);
+        // unmapped user buffer -> short write (or -1 if nothing went out)
+        if (copy_from_user(kbuf, ubuf + wrote, n) < 0) return wrote ? (int32_t)wrote : -1;
+        terminal_write(kbuf, n);
+        wrote += n;
     }
-    return wrote;
+    return (int32_t)wrote;
+}
+
+uint32_t sys_write(regs_t* r) {
+    return (uint32_t)ksys_write(r->ebx, (const char*)r->ecx, r->edx);
+}
+
+#define SYSCALL_ENTRY(n, name) [n] = sys_##name,
+static const syscall_fn g_syscalls[SYSCALL_MAX] = { SYSCALL_LIST(SYSCALL_ENTRY) };
+#undef SYSCALL_ENTRY
+
+#define SYSCALL_NAME(n, name) [n] = #name,
+static const char* const g_names[SYSCALL_MAX] = { SYSCALL_LIST(SYSCALL_NAME) };
+#undef SYSCALL_NAME
+
+static syscall_stat_t g_stats[SYSCALL_MAX];
+static int g_tsc = -1;   // -1 = not probed yet
+
+static uint32_t hist_bucket(uint64_t cycles) {
+    uint32_t b = 0;
+    uint64_t lim = 128;
+    while (b + 1 < SYSCALL_HIST_BUCKETS && cycles >= lim) { lim <<= 1; b++; }
+    return b;
 }
 
 void syscall_handle(regs_t* r) {
     uint32_t num = r->eax;
-
-    switch (num) {
-    case 4: { // write
-        uint32_t fd  = r->ebx;
-        const char* buf = (const char*)r->ecx;
-        uint32_t len = r->edx;
-        r->eax = (uint32_t)sys_write(fd, buf, len);
+    if (num >= SYSCALL_MAX || !g_syscalls[num]) {
+        r->eax = (uint32_t)-1;
         return;
     }
-    default:
-        r->eax = (uint32_t)-1;
+    proc_t* p = proc_current();
+    if (p) p->syscalls++;
+
+    if (g_tsc < 0) g_tsc = (cpuid_edx(1) & CPUID_EDX_TSC) ? 1 : 0;
+    if (!g_tsc) {
+        g_stats[num].calls++;
+        r->eax = g_syscalls[num](r);
         return;
     }
+
+    uint64_t t0 = rdtsc();
+    r->eax = g_syscalls[num](r);
+    uint64_t dt = rdtsc() - t0;
+
+    syscall_stat_t* s = &g_stats[num];
+    s->calls++;
+    s->cycles += dt;
+    s->hist[hist_bucket(dt)]++;
+}
+
+const syscall_stat_t* syscall_stat(uint32_t num) {
+    if (num >= SYSCALL_MAX || !g_syscalls[num]) return 0;
+    return &g_stats[num];
+}
+
+const char* syscall_name(uint32_t num) {
+    return num < SYSCALL_MAX ? g_names[num] : 0;
+}
+
+void syscall_stats_reset(void) {
+    memset(g_stats, 0, sizeof(g_stats));
 }
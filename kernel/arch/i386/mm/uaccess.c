@@ -0,0 +1,78 @@
+#include <stdint.h>
+#include <arch/i386/paging.h>
+#include <arch/i386/uaccess.h>
+
+typedef struct {
+    uint32_t insn;    // eip of the instruction allowed to fault
+    uint32_t fixup;   // where to resume
+} extable_entry_t;
+
+// linker symbols (see linker.ld)
+extern const extable_entry_t __ex_table_start[];
+extern const extable_entry_t __ex_table_end[];
+
+extern uint32_t __copy_user(void* dst, const void* src, uint32_t n);
+extern int __strncpy_user(char* dst, const char* src, uint32_t n);
+
+// How many of the 'len' bytes at 'a' sit on pages user mode could touch,
+// stopping at the first kernel page (identity map, kernel-high tables).
+static uint32_t user_span(uint32_t a, uint32_t len) {
+    if (a < USER_SPACE_START || a >= USER_SPACE_END) return 0;
+    if (len > USER_SPACE_END - a) len = USER_SPACE_END - a;
+
+    const uint32_t* pd = paging_current_pd_virt();
+    uint32_t done = 0;
+    while (done < len) {
+        uint32_t va = a + done;
+        uint32_t pde = pd[(va >> 22) & 0x3FFu];
+        if (pde & P_PRESENT) {
+            if (!(pde & P_USER)) break;
+            uint32_t pte = ((const uint32_t*)(pde & 0xFFFFF000u))[(va >> 12) & 0x3FFu];
+            if ((pte & P_PRESENT) && !(pte & P_USER)) break;
+        }
+        done += PAGE_SIZE - (va & 0xFFFu);
+    }
+    return done < len ? done : len;
+}
+
+int access_ok(const void* uptr, uint32_t len) {
+    uint32_t a = (uint32_t)uptr;
+    if (len == 0) return a >= USER_SPACE_START && a <= USER_SPACE_END;
+    return user_span(a, len) == len;
+}
+
+int copy_from_user(void* dst, const void* usrc, uint32_t n) {
+    if (!access_ok(usrc, n)) return -1;
+    return __copy_user(dst, usrc, n) ? -1 : 0;
+}
+
+int copy_to_user(void* udst, const void* src, uint32_t n) {
+    if (!access_ok(udst, n)) return -1;
+    return __copy_user(udst, src, n) ? -1 : 0;
+}
+
+uint32_t copy_to_user_partial(void* udst, const void* src, uint32_t n) {
+    if (!access_ok(udst, n)) return 0;
+    return n - __copy_user(udst, src, n);
+}
+
+int strncpy_from_user(char* dst, const char* usrc, uint32_t n) {
+    // never walk past the last user page looking for the NUL
+    uint32_t room = user_span((uint32_t)usrc, n);
+    if (!room) return -1;
+    int r = __strncpy_user(dst, usrc, room);
+    // cut short by a kernel page: that's a fault, not a long string
+    if (r >= 0 && (uint32_t)r == room && room < n) return -1;
+    return r;
+}
+
+int extable_fixup(regs_t* r) {
+    // only a handful of entries, a linear scan is fine
+    for (const extable_entry_t* e = __ex_table_start; e < __ex_table_end; e++) {
+        if (e->insn == r->eip) {
+            r->eip = e->fixup;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,133 @@
+#include <stdint.h>
+#include <string.h>
+#include <arch/i386/cpu.h>
+#include <arch/i386/paging.h>
+#include <arch/i386/syscall.h>
+#include <arch/i386/uring.h>
+#include <arch/i386/ufd.h>
+#include <arch/i386/proc.h>
+#include <arch/i386/smp.h>
+
+#define URING_POLL_BATCH 16   // per tick, keeps the return to user mode short
+
+// One ring per process, set up on demand. The kernel reaches it through a
+// kmap of its frame, never through URING_VA, so nothing depends on which
+// directory is loaded; the I/O it describes still runs on the owning
+// process's thread (syscall, or the poll pass on its way back to user mode).
+
+static int32_t uring_exec(const struct uring_sqe* s) {
+    switch (s->op) {
+    case URING_OP_NOP:
+        return 0;
+    case URING_OP_WRITE:
+        return ksys_write((uint32_t)s->fd, (const char*)s->addr, s->len);
+    case URING_OP_READ:
+        return (s->off == URING_OFF_CUR) ? ufd_read(s->fd, (void*)s->addr, s->len)
+                                         : ufd_pread(s->fd, (void*)s->addr, s->len, s->off);
+    case URING_OP_OPEN:
+        return ufd_open((const char*)s->addr);
+    case URING_OP_CLOSE:
+        return ufd_close(s->fd);
+    default:
+        return -1;
+    }
+}
+
+// Take the next SQE off the ring, if any. A bogus sq_tail (the user owns
+// it) just empties the queue.
+static int sq_pop(uint32_t frame, struct uring_sqe* sqe) {
+    int got = 0;
+    uint32_t f = irq_save();
+    struct uring* u = (struct uring*)paging_kmap(frame);
+    uint32_t head = u->sq_head, tail = u->sq_tail;
+    if (tail - head > URING_SQ_ENTRIES) {
+        u->sq_head = tail;
+    } else if (head != tail) {
+        // snapshot: the user can't change the request under us
+        *sqe = u->sq[head & (URING_SQ_ENTRIES - 1)];
+        u->sq_head = head + 1;
+        got = 1;
+    }
+    paging_kunmap(u);
+    irq_restore(f);
+    return got;
+}
+
+static void cq_post(uint32_t frame, uint32_t user_data, int32_t res) {
+    uint32_t f = irq_save();
+    struct uring* u = (struct uring*)paging_kmap(frame);
+    if (u->cq_tail - u->cq_head >= URING_CQ_ENTRIES) {
+        u->cq_overflow++;
+    } else {
+        struct uring_cqe* c = &u->cq[u->cq_tail & (URING_CQ_ENTRIES - 1)];
+        c->user_data = user_data;
+        c->res = res;
+        __asm__ volatile ("" ::: "memory");   // CQE before tail (x86 keeps store order)
+        u->cq_tail++;
+    }
+    paging_kunmap(u);
+    irq_restore(f);
+}
+
+// Consume up to 'max' SQEs, posting a CQE for each. Returns how many.
+// The ring is only mapped while its indices move, not across the I/O.
+static uint32_t uring_drain(uint32_t frame, uint32_t max) {
+    uint32_t done = 0;
+    struct uring_sqe sqe;
+    while (done < max && sq_pop(frame, &sqe)) {
+        cq_post(frame, sqe.user_data, uring_exec(&sqe));
+        done++;
+    }
+    return done;
+}
+
+// uring_setup(flags) -> ring VA, mapped into the calling process once
+uint32_t sys_uring_setup(regs_t* r) {
+    proc_t* p = proc_current();
+    if (!p) return (uint32_t)-1;
+
+    if (!p->uring_frame) {
+        if (!paging_translate_in(p->dir, URING_VA) &&
+            paging_alloc_map_in(p->dir, URING_VA, P_PRESENT | P_RW | P_USER) < 0) {
+            return (uint32_t)-1;
+        }
+        if (paging_memset_in_dir(p->dir, URING_VA, 0, PAGE_SIZE) < 0) return (uint32_t)-1;
+        p->uring_frame = paging_translate_in(p->dir, URING_VA) & 0xFFFFF000u;
+    }
+
+    p->uring_flags = r->ebx & URING_F_POLL;
+    uint32_t f = irq_save();
+    struct uring* u = (struct uring*)paging_kmap(p->uring_frame);
+    u->flags = p->uring_flags;
+    paging_kunmap(u);
+    irq_restore(f);
+    return URING_VA;
+}
+
+// uring_enter(n) -> SQEs consumed; all of them have completed on return
+uint32_t sys_uring_enter(regs_t* r) {
+    proc_t* p = proc_current();
+    if (!p || !p->uring_frame) return (uint32_t)-1;
+
+    uint32_t n = r->ebx;
+    if (n > URING_SQ_ENTRIES) n = URING_SQ_ENTRIES;
+    return uring_drain(p->uring_frame, n);
+}
+
+void uring_poll_tick(regs_t* r) {
+    // only at a clean user-mode boundary of the owning process
+    if ((r->cs & 3) != 3) return;
+
+    proc_t* p = proc_current();
+    if (p && (p->uring_flags & URING_F_POLL)) p->uring_kick = 1;
+}
+
+void uring_poll_user(void) {
+    proc_t* p = proc_current();
+    if (!p || !p->uring_kick) return;
+    p->uring_kick = 0;
+
+    bkl_lock();
+    uring_drain(p->uring_frame, URING_POLL_BATCH);
+    bkl_unlock();
+}
@@ -0,0 +1,276 @@
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <kernel/vfs.h>
+#include <arch/i386/paging.h>
+#include <arch/i386/pmm.h>
+#include <arch/i386/uaccess.h>
+#include <arch/i386/syscall.h>
+#include <arch/i386/uvm.h>
+#include <arch/i386/ufd.h>
+#include <arch/i386/proc.h>
+
+static uint32_t align_down(uint32_t x) { return x & 0xFFFFF000u; }
+static uint32_t align_up(uint32_t x)   { return (x + 0xFFFu) & 0xFFFFF000u; }
+
+// The calling process's address space, with its directory loaded. 0 on kernel threads.
+static uvm_t* uvm_cur(void) {
+    proc_t* p = proc_current();
+    if (!p || !p->uvm.dir.pd_virt || p->uvm.dir.pd_virt != paging_current_pd_virt()) return 0;
+    return &p->uvm;
+}
+
+const uvm_t* uvm_current(void) {
+    return uvm_cur();
+}
+
+// Drop whatever got faulted in over [start, end) and give the frames back.
+static void free_range(uvm_t* vm, uint32_t start, uint32_t end) {
+    for (uint32_t va = start; va < end && va >= start; ) {
+        // no page table, nothing was ever touched in this 4MB
+        if (!(vm->dir.pd_virt[va >> 22] & P_PRESENT)) {
+            va = (va & 0xFFC00000u) + 0x400000u;
+            continue;
+        }
+        uint32_t old = paging_unmap_in(vm->dir, va);
+        if (old & P_PRESENT) {
+            if (!(old & P_SHARED)) pmm_free_frame(old & 0xFFFFF000u);
+            vm->resident--;
+        }
+        va += PAGE_SIZE;
+    }
+}
+
+void uvm_init(uvm_t* vm, page_directory_t dir) {
+    memset(vm, 0, sizeof(*vm));
+    vm->dir = dir;
+    vm->brk = UVM_HEAP_BASE;
+}
+
+static uvm_region_t* find_region(uvm_t* vm, uint32_t addr) {
+    for (uint32_t i = 0; i < vm->nregions; i++) {
+        if (addr >= vm->regions[i].start && addr < vm->regions[i].end) return &vm->regions[i];
+    }
+    return 0;
+}
+
+// Copy file bytes [src, src+len) into the frame at 'dst' + off. The source
+// is reached through the kernel directory, a user mapping may hide it here.
+static void copy_file_bytes(uint8_t* dst, const uint8_t* src, uint32_t len) {
+    page_directory_t kdir = paging_kernel_directory();
+    while (len) {
+        uint32_t s = (uint32_t)src;
+        uint32_t n = PAGE_SIZE - (s & 0xFFFu);
+        if (n > len) n = len;
+
+        uint8_t* p = (uint8_t*)paging_kmap(paging_translate_in(kdir, s) & 0xFFFFF000u);
+        memcpy(dst, p + (s & 0xFFFu), n);
+        paging_kunmap(p);
+
+        dst += n;
+        src += n;
+        len -= n;
+    }
+}
+
+int uvm_fault(uint32_t addr, uint32_t err) {
+    if (err & 1) return 0;              // protection fault, page was there
+
+    uvm_t* vm = uvm_cur();
+    if (!vm) return 0;
+
+    uint32_t page = align_down(addr);
+    uint32_t flags = P_PRESENT | P_USER;
+    uvm_region_t* rg = 0;
+
+    if (addr >= UVM_HEAP_BASE && addr < align_up(vm->brk)) {
+        flags |= P_RW;
+    } else {
+        rg = find_region(vm, addr);
+        if (!rg) return 0;
+        if (rg->flags & UVM_R_WRITE) flags |= P_RW;
+    }
+
+    uint32_t foff = 0, fbytes = 0;
+    if (rg && rg->file) {
+        foff = rg->file_off + (page - rg->start);
+        fbytes = foff < rg->file_size ? rg->file_size - foff : 0;
+        if (fbytes > PAGE_SIZE) fbytes = PAGE_SIZE;
+
+        // whole read-only page of file bytes on a frame boundary: map it as is
+        uint32_t src = (uint32_t)rg->file + foff;
+        if (!(flags & P_RW) && fbytes == PAGE_SIZE && !(src & 0xFFFu)) {
+            uint32_t phys = paging_translate_in(paging_kernel_directory(), src);
+            if (phys && paging_map_in(vm->dir, page, phys, flags | P_SHARED) == 0) {
+                vm->resident++;
+                return 1;
+            }
+        }
+    }
+
+    uint32_t frame = (uint32_t)pmm_alloc_frame();
+    if (!frame) return 0;
+
+    // fill through a kmap: the page may be read-only to us once mapped
+    uint8_t* p = (uint8_t*)paging_kmap(frame);
+    memset(p + fbytes, 0, PAGE_SIZE - fbytes);
+    if (fbytes) copy_file_bytes(p, rg->file + foff, fbytes);
+    paging_kunmap(p);
+
+    if (paging_map_in(vm->dir, page, frame, flags) < 0) {
+        pmm_free_frame(frame);
+        return 0;
+    }
+    vm->resident++;
+    return 1;
+}
+
+static int insert_region(uvm_t* vm, const uvm_region_t* nr) {
+    uint32_t i = 0;
+    while (i < vm->nregions && vm->regions[i].start < nr->start) i++;
+
+    // extend an anonymous neighbour instead of using a slot
+    if (!nr->file) {
+        uvm_region_t* prev = i > 0 ? &vm->regions[i - 1] : 0;
+        uvm_region_t* next = i < vm->nregions ? &vm->regions[i] : 0;
+        if (prev && !prev->file && prev->end == nr->start && prev->flags == nr->flags) {
+            prev->end = nr->end;
+            return 0;
+        }
+        if (next && !next->file && next->start == nr->end && next->flags == nr->flags) {
+            next->start = nr->start;
+            return 0;
+        }
+    }
+
+    if (vm->nregions >= UVM_MAX_REGIONS) return -1;
+    memmove(&vm->regions[i + 1], &vm->regions[i], (vm->nregions - i) * sizeof(uvm_region_t));
+    vm->regions[i] = *nr;
+    vm->nregions++;
+    return 0;
+}
+
+// Move a region's start up to 'to' (file view follows).
+static void trim_front(uvm_region_t* rg, uint32_t to) {
+    if (rg->file) rg->file_off += to - rg->start;
+    rg->start = to;
+}
+
+// first fit at or above 'from'
+static uint32_t find_gap(uvm_t* vm, uint32_t from, uint32_t len) {
+    uint32_t at = from;
+    for (uint32_t i = 0; i < vm->nregions; i++) {
+        uvm_region_t* rg = &vm->regions[i];
+        if (rg->end <= at) continue;
+        if (rg->start >= at + len) break;
+        at = rg->end;
+    }
+    return (at + len <= UVM_MMAP_END && at + len > at) ? at : 0;
+}
+
+int uvm_unmap(uint32_t addr, uint32_t len) {
+    uvm_t* vm = uvm_cur();
+    if (!vm || (addr & 0xFFFu) || len == 0) return -1;
+
+    uint32_t start = addr, end = addr + align_up(len);
+    if (end <= start) return -1;
+
+    for (uint32_t i = 0; i < vm->nregions; ) {
+        uvm_region_t* rg = &vm->regions[i];
+        if (rg->end <= start || rg->start >= end) { i++; continue; }
+
+        uint32_t lo = rg->start > start ? rg->start : start;
+        uint32_t hi = rg->end < end ? rg->end : end;
+
+        if (lo > rg->start && hi < rg->end) {
+            // hole in the middle: split in two
+            if (vm->nregions >= UVM_MAX_REGIONS) return -1;
+            memmove(&vm->regions[i + 1], &vm->regions[i], (vm->nregions - i) * sizeof(uvm_region_t));
+            vm->nregions++;
+            vm->regions[i].end = lo;
+            trim_front(&vm->regions[i + 1], hi);
+            free_range(vm, lo, hi);
+            i += 2;
+        } else if (lo > rg->start) {
+            rg->end = lo;
+            free_range(vm, lo, hi);
+            i++;
+        } else if (hi < rg->end) {
+            trim_front(rg, hi);
+            free_range(vm, lo, hi);
+            i++;
+        } else {
+            free_range(vm, lo, hi);
+            memmove(rg, rg + 1, (vm->nregions - i - 1) * sizeof(uvm_region_t));
+            vm->nregions--;
+        }
+    }
+    return 0;
+}
+
+uint32_t uvm_map(uint32_t hint, uint32_t len, uint32_t flags, int fixed,
+                 const uint8_t* file, uint32_t file_size, uint32_t file_off) {
+    uvm_t* vm = uvm_cur();
+    if (!vm || len == 0) return 0;
+
+    len = align_up(len);
+    if (len == 0) return 0;
+
+    uint32_t at;
+    if (fixed) {
+        if ((hint & 0xFFFu) || hint < UVM_MMAP_BASE || hint + len > UVM_MMAP_END || hint + len < hint) return 0;
+        if (uvm_unmap(hint, len) < 0) return 0;
+        at = hint;
+    } else {
+        uint32_t from = (hint >= UVM_MMAP_BASE && hint < UVM_MMAP_END) ? align_down(hint) : UVM_MMAP_BASE;
+        at = find_gap(vm, from, len);
+        if (!at && from != UVM_MMAP_BASE) at = find_gap(vm, UVM_MMAP_BASE, len);
+        if (!at) return 0;
+    }
+
+    uvm_region_t nr = { at, at + len, flags, file, file_size, file_off };
+    if (insert_region(vm, &nr) < 0) return 0;
+    return at;
+}
+
+// brk(addr) -> new break; 0 or an invalid addr just reports the current one
+uint32_t sys_brk(regs_t* r) {
+    uvm_t* vm = uvm_cur();
+    if (!vm) return (uint32_t)-1;
+
+    uint32_t want = r->ebx;
+    if (want < UVM_HEAP_BASE || want > UVM_HEAP_MAX) return vm->brk;
+
+    // shrinking hands the pages back right away
+    if (align_up(want) < align_up(vm->brk)) free_range(vm, align_up(want), align_up(vm->brk));
+    vm->brk = want;
+    return vm->brk;
+}
+
+// mmap(&mmap_args) -> address or (uint32_t)-1. Anonymous memory, or a
+// resident (initrd) file: read-only if shared, private copies otherwise.
+uint32_t sys_mmap(regs_t* r) {
+    struct mmap_args a;
+    if (copy_from_user(&a, (const void*)r->ebx, sizeof(a)) < 0) return (uint32_t)-1;
+
+    uint32_t flags = (a.prot & PROT_WRITE) ? UVM_R_WRITE : 0;
+    int fixed = (a.flags & MAP_FIXED) != 0;
+
+    const uint8_t* file = 0;
+    uint32_t size = 0;
+    if (!(a.flags & MAP_ANONYMOUS)) {
+        int vfd = ufd_vfs(a.fd);
+        if (vfd < 0) return (uint32_t)-1;
+        file = (const uint8_t*)vfs_data(vfd, &size);
+        if (!file || a.off > size) return (uint32_t)-1;
+        // nothing can write back to the initrd
+        if ((a.flags & MAP_SHARED) && (a.prot & PROT_WRITE)) return (uint32_t)-1;
+    }
+
+    uint32_t at = uvm_map(a.addr, a.len, flags, fixed, file, size, a.off);
+    return at ? at : (uint32_t)-1;
+}
+
+uint32_t sys_munmap(regs_t* r) {
+    return (uint32_t)uvm_unmap(r->ebx, r->ecx);
+}
@@ -0,0 +1,122 @@
+// proc.c
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <kernel/panic.h>
+#include <kernel/elf_cache.h>
+#include <arch/i386/cpu.h>
+#include <arch/i386/tss.h>
+#include <arch/i386/paging.h>
+#include <arch/i386/usermode.h>
+#include <arch/i386/smp.h>
+#include <arch/i386/proc.h>
+
+static proc_t g_procs[PROC_MAX];
+static uint32_t g_next_pid = 1;
+
+proc_t* proc_alloc(const char* name) {
+    uint32_t f = irq_save();
+
+    proc_t* p = 0;
+    for (int i = 0; i < PROC_MAX; i++) {
+        if (g_procs[i].state == PROC_UNUSED) {
+            p = &g_procs[i];
+            break;
+        }
+    }
+    if (p) {
+        memset(p, 0, sizeof(*p));
+        p->pid = g_next_pid++;
+        p->state = PROC_LOADING;
+
+        size_t n = strlen(name);
+        if (n >= PROC_NAME_LEN) n = PROC_NAME_LEN - 1;
+        memcpy(p->name, name, n);
+        p->name[n] = '\0';
+    }
+
+    irq_restore(f);
+    return p;
+}
+
+// everything but the thread: the caller is done with the address space
+static void proc_release(proc_t* p) {
+    ufd_close_all(&p->fds);
+    if (p->dir.pd_virt) paging_free_directory(p->dir);
+    elf_cache_put(p->image);        // its frames aren't mapped anywhere now
+    memset(p, 0, sizeof(*p));
+}
+
+void proc_free(proc_t* p) {
+    uint32_t f = irq_save();
+    proc_release(p);
+    irq_restore(f);
+}
+
+// First thing the process thread does; CR3 and esp0 are already ours.
+// User mode doesn't hold the BKL; the next trap takes it again.
+static void proc_thread_main(void* arg) {
+    proc_t* p = (proc_t*)arg;
+    bkl_unlock();
+    __asm__ volatile ("cli");       // iret turns them back on
+    sched_acct_user_return();
+    enter_user(p->entry, p->user_stack_top);
+}
+
+int proc_start(proc_t* p, uint32_t entry, uint32_t user_stack_top) {
+    p->entry = entry;
+    p->user_stack_top = user_stack_top;
+
+    // the thread may be picked by the next tick: finish the proc first
+    uint32_t f = irq_save();
+    thread_t* t = thread_spawn(p->name, proc_thread_main, p, p);
+    if (t) {
+        p->thread = t;
+        p->kstack_top = (uint32_t)t->stack + THREAD_STACK_SIZE;
+        p->state = PROC_RUNNING;
+    }
+    irq_restore(f);
+    return t ? 0 : -1;
+}
+
+proc_t* proc_current(void) {
+    thread_t* t = thread_current();
+    return t ? t->proc : 0;
+}
+
+const proc_t* proc_get(int i) {
+    if (i < 0 || i >= PROC_MAX) return 0;
+    if (g_procs[i].state == PROC_UNUSED) return 0;
+    return &g_procs[i];
+}
+
+uint32_t proc_resident_frames(const proc_t* p) {
+    return p->image_frames + p->uvm.resident;
+}
+
+regs_t* proc_user_regs(const proc_t* p) {
+    return (regs_t*)(p->kstack_top - sizeof(regs_t));
+}
+
+void proc_exit(int32_t code) {
+    __asm__ volatile ("cli");
+    proc_t* p = proc_current();
+    if (!p) panic("proc_exit from a kernel thread");
+
+    printf("\n[pid %u exited: %d]\n", p->pid, code);
+
+    // off the directory before freeing it; the thread dies with IRQs off,
+    // and its slot stays taken until the final switch is done (on_cpu)
+    paging_switch_directory(paging_kernel_directory());
+    p->thread->proc = 0;
+    proc_release(p);
+    thread_exit();
+}
+
+void proc_switch_in(const thread_t* t) {
+    page_directory_t dir = t->proc ? t->proc->dir : paging_kernel_directory();
+    if (dir.pd_virt && dir.pd_virt != paging_current_pd_virt()) paging_switch_directory(dir);
+    // from the thread, not p->kstack_top: another CPU can pick the thread
+    // up before proc_start has filled the proc in
+    if (t->proc) tss_set_kernel_stack((uint32_t)t->stack + THREAD_STACK_SIZE);
+}
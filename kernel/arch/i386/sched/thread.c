@@ -0,0 +1,621 @@
+// thread.c
+#include <stdint.h>
+#include <string.h>
+#include <kernel/panic.h>
+#include <arch/i386/cpu.h>
+#include <arch/i386/spinlock.h>
+#include <arch/i386/smp.h>
+#include <arch/i386/thread.h>
+#include <arch/i386/proc.h>
+#include <arch/i386/fpu.h>
+
+// written at the low end of every thread stack, checked on each switch away
+#define THREAD_STACK_MAGIC 0x57AC4B1Du
+
+static thread_t g_threads[THREAD_MAX];
+// threads without a stack here (stack == 0) are the CPUs' boot contexts:
+// "main" on the BSP and each AP's idle thread. They are pinned.
+static uint8_t g_stacks[THREAD_MAX][THREAD_STACK_SIZE] __attribute__((aligned(16)));
+static spinlock_t g_threads_lock = SPINLOCK_INIT;   // slot allocation
+static uint32_t g_next_id = 1;
+
+// One FIFO per level, READY threads only (the running one is off the lists).
+// Bit n of rq_bitmap is set while level n is non-empty, so pick-next is a
+// single bit scan no matter how many threads are queued.
+typedef struct {
+    thread_t* head;
+    thread_t* tail;
+    uint32_t len;
+} runqueue_t;
+
+// Everything the scheduler keeps per CPU. current, slice and the tick
+// counters are only touched by their own CPU with IRQs off; the queues are
+// also fed by thread_wake/thread_spawn and raided by other CPUs' balancers,
+// so they (and current, which those peek at) change under 'lock' only.
+typedef struct {
+    spinlock_t lock;
+    int online;
+    thread_t* current;
+    thread_t* idle;                 // set by sched_idle, never queued
+    thread_t* prev;                 // switched away from, until finish_switch
+    runqueue_t rq[SCHED_LEVELS];
+    uint32_t rq_bitmap;
+    volatile uint32_t nr_ready;
+    uint32_t slice;                 // ticks left for current
+    uint32_t boost_in;
+    uint32_t balance_in;
+    volatile int need_resched;
+    int slice_expired;              // the pending switch is a demotion
+    uint32_t migrations;
+    uint64_t ticks;
+    uint64_t idle_ticks;
+    sched_level_stat_t stats[SCHED_LEVELS];
+} sched_cpu_t;
+
+static sched_cpu_t g_cpus[CPU_MAX];
+
+static uint32_t g_quantum = SCHED_QUANTUM_DEFAULT;
+static int g_tsc = 0;
+
+static inline sched_cpu_t* this_cpu(void) {
+    return &g_cpus[cpu_id()];
+}
+
+static uint64_t now_tsc(void) {
+    return g_tsc ? rdtsc() : 0;
+}
+
+// close t's open stretch at 'now', as user or kernel time
+static void acct_charge(thread_t* t, uint64_t now) {
+    uint64_t d = now - t->acct_tsc;
+    if (t->in_user) t->utime += d;
+    else t->stime += d;
+    t->acct_tsc = now;
+}
+
+static uint32_t level_slice(uint32_t level) {
+    return g_quantum * (level + 1);
+}
+
+static void rq_push(sched_cpu_t* c, thread_t* t) {
+    runqueue_t* q = &c->rq[t->level];
+    t->next = 0;
+    if (q->tail) q->tail->next = t;
+    else q->head = t;
+    q->tail = t;
+    q->len++;
+    c->nr_ready++;
+    c->rq_bitmap |= 1u << t->level;
+    t->enq_tsc = now_tsc();
+}
+
+// unlink t, which follows 'prev' (0 if it's the head) on its level's list
+static void rq_remove(sched_cpu_t* c, thread_t* prev, thread_t* t) {
+    runqueue_t* q = &c->rq[t->level];
+    if (prev) prev->next = t->next;
+    else q->head = t->next;
+    if (q->tail == t) q->tail = prev;
+    if (!q->head) c->rq_bitmap &= ~(1u << t->level);
+    q->len--;
+    c->nr_ready--;
+    t->next = 0;
+}
+
+static thread_t* rq_pop(sched_cpu_t* c) {
+    if (!c->rq_bitmap) return 0;
+    uint32_t level = (uint32_t)__builtin_ctz(c->rq_bitmap);
+
+    thread_t* t = c->rq[level].head;
+    rq_remove(c, 0, t);
+
+    sched_level_stat_t* s = &c->stats[level];
+    s->dispatches++;
+    if (g_tsc) {
+        uint64_t w = rdtsc() - t->enq_tsc;
+        s->wait_cycles += w;
+        if (w > s->wait_max) s->wait_max = w;
+    }
+    return t;
+}
+
+// Periodic boost: splice every lower level onto level 0, in level order.
+static void boost_all(sched_cpu_t* c) {
+    runqueue_t* top = &c->rq[0];
+    for (uint32_t l = 1; l < SCHED_LEVELS; l++) {
+        runqueue_t* q = &c->rq[l];
+        if (!q->head) continue;
+        for (thread_t* t = q->head; t; t = t->next) t->level = 0;
+        if (top->tail) top->tail->next = q->head;
+        else top->head = q->head;
+        top->tail = q->tail;
+        top->len += q->len;
+        q->head = q->tail = 0;
+        q->len = 0;
+    }
+    if (top->head) c->rq_bitmap = 1u;
+    if (c->current) c->current->level = 0;
+}
+
+// what the balancer and placement compare: queued plus the one running
+static uint32_t cpu_load(const sched_cpu_t* c) {
+    return c->nr_ready + (c->current && c->current != c->idle ? 1u : 0u);
+}
+
+// Lowest-priority READY thread that may move. Caller holds c->lock.
+static thread_t* rq_steal(sched_cpu_t* c) {
+    for (int l = SCHED_LEVELS - 1; l >= 0; l--) {
+        if (!(c->rq_bitmap & (1u << l))) continue;
+        thread_t* prev = 0;
+        for (thread_t* t = c->rq[l].head; t; prev = t, t = t->next) {
+            if (!t->pinned && !t->on_cpu) {
+                rq_remove(c, prev, t);
+                return t;
+            }
+        }
+    }
+    return 0;
+}
+
+// Pull one thread from the busiest CPU if it's 2+ threads ahead of us.
+// Both queue locks, lower index first so two balancers can't deadlock.
+static void balance(sched_cpu_t* c) {
+    sched_cpu_t* busiest = 0;
+    uint32_t max = 0;
+    for (uint32_t i = 0; i < CPU_MAX; i++) {
+        sched_cpu_t* o = &g_cpus[i];
+        if (o == c || !o->online || !o->nr_ready) continue;
+        uint32_t load = cpu_load(o);
+        if (load > max) {
+            max = load;
+            busiest = o;
+        }
+    }
+    if (!busiest || max < cpu_load(c) + 2) return;
+
+    sched_cpu_t* first = c < busiest ? c : busiest;
+    sched_cpu_t* second = c < busiest ? busiest : c;
+    spin_lock(&first->lock);
+    spin_lock(&second->lock);
+
+    // looked without the locks, check again
+    thread_t* t = cpu_load(busiest) >= cpu_load(c) + 2 ? rq_steal(busiest) : 0;
+    if (t) {
+        uint64_t since = t->enq_tsc;
+        t->cpu = (uint32_t)(c - g_cpus);
+        t->migrations++;
+        c->migrations++;
+        rq_push(c, t);
+        t->enq_tsc = since;         // still waiting, just somewhere else
+        if (c->current == c->idle || t->level < c->current->level) c->need_resched = 1;
+    }
+
+    spin_unlock(&second->lock);
+    spin_unlock(&first->lock);
+}
+
+static void set_name(thread_t* t, const char* name) {
+    size_t n = strlen(name);
+    if (n >= THREAD_NAME_LEN) n = THREAD_NAME_LEN - 1;
+    memcpy(t->name, name, n);
+    t->name[n] = '\0';
+}
+
+// The other half of a switch, run on the new thread's stack: the old one
+// has its context saved now, so its slot and queue spot are safe to reuse.
+static void finish_switch(void) {
+    sched_cpu_t* c = this_cpu();
+    if (c->prev) {
+        __atomic_store_n(&c->prev->on_cpu, 0, __ATOMIC_RELEASE);
+        c->prev = 0;
+    }
+    spin_unlock(&c->lock);
+}
+
+// IRQs off. Requeue the running thread (unless it is blocking or exiting,
+// or is the idle thread) and switch to the head of the highest non-empty
+// level, or to idle when there is none.
+//
+// The queue lock is held across context_switch, so nobody else can pick
+// prev off our queue before its registers are saved; the next thread drops
+// it in finish_switch. The BKL goes the other way: released before we take
+// the queue lock, and each thread takes back its own depth on resume.
+static void schedule(void) {
+    sched_cpu_t* c = this_cpu();
+    thread_t* prev = c->current;
+
+    if (prev->stack && *(uint32_t*)prev->stack != THREAD_STACK_MAGIC) {
+        panic("thread stack overflow");
+    }
+
+    uint32_t depth = bkl_release_all();
+    spin_lock(&c->lock);
+
+    if (prev->state == THREAD_RUNNING) {
+        prev->state = THREAD_READY;
+        if (prev != c->idle) {
+            // used its whole slice: CPU-bound, drop a level
+            if (c->slice_expired && prev->level + 1 < SCHED_LEVELS) {
+                prev->level++;
+                c->stats[prev->level].demotions++;
+            }
+            rq_push(c, prev);
+        }
+    }
+    c->slice_expired = 0;
+    c->need_resched = 0;
+
+    thread_t* next = rq_pop(c);
+    if (!next) next = c->idle;
+    if (!next) panic("schedule: nothing to run");
+
+    c->slice = level_slice(next->level);
+    next->state = THREAD_RUNNING;
+    if (next == prev) {
+        spin_unlock(&c->lock);
+        bkl_reacquire(depth);
+        return;
+    }
+
+    if (g_tsc) {
+        uint64_t now = rdtsc();
+        acct_charge(prev, now);
+        next->acct_tsc = now;
+    }
+    next->switches++;
+    next->cpu = (uint32_t)(c - g_cpus);
+    next->on_cpu = 1;
+    c->current = next;
+    c->prev = prev;
+    prev->bkl_depth = depth;
+    fpu_switch_out(prev);           // sets CR0.TS: next traps on its first FPU use
+    proc_switch_in(next);
+    context_switch(&prev->esp, next->esp);
+
+    // resumed, possibly on another CPU
+    finish_switch();
+    bkl_reacquire(prev->bkl_depth);
+}
+
+// First code a new thread runs: context_switch "returns" here with IF=0
+static void thread_start(void) {
+    finish_switch();
+    bkl_lock();                     // kernel threads run under the BKL, see smp.h
+    __asm__ volatile ("sti");
+    thread_t* t = thread_current();
+    t->fn(t->arg);
+    thread_exit();
+}
+
+static void cpu_init(sched_cpu_t* c, thread_t* boot) {
+    static const char* rq_names[CPU_MAX] = { "rq0", "rq1", "rq2", "rq3", "rq4", "rq5", "rq6", "rq7" };
+    spin_init(&c->lock, rq_names[c - g_cpus]);
+    c->current = boot;
+    c->slice = level_slice(0);
+    c->boost_in = SCHED_BOOST_TICKS;
+    c->balance_in = SCHED_BALANCE_TICKS;
+    c->online = 1;
+}
+
+// A slot that's free, or DEAD and fully switched away from. Returns it
+// marked READY so nobody else takes it; *slot gets its index.
+static thread_t* slot_alloc(const char* name, int* slot) {
+    thread_t* t = 0;
+    spin_lock(&g_threads_lock);
+    for (int i = 1; i < THREAD_MAX; i++) {
+        thread_t* c = &g_threads[i];
+        if (c->state == THREAD_UNUSED || (c->state == THREAD_DEAD && !c->on_cpu)) {
+            t = c;
+            *slot = i;
+            memset(t, 0, sizeof(*t));
+            t->id = g_next_id++;
+            t->state = THREAD_READY;
+            set_name(t, name);
+            fpu_thread_init(t);
+            break;
+        }
+    }
+    spin_unlock(&g_threads_lock);
+    return t;
+}
+
+void sched_init(void) {
+    thread_t* t = &g_threads[0];
+    memset(t, 0, sizeof(*t));
+    t->id = 0;
+    t->state = THREAD_RUNNING;
+    t->on_cpu = 1;
+    t->pinned = 1;
+    set_name(t, "main");
+    fpu_thread_init(t);
+
+    g_tsc = (cpuid_edx(1) & CPUID_EDX_TSC) ? 1 : 0;
+    t->acct_tsc = now_tsc();
+    spin_init(&g_threads_lock, "threads");
+    cpu_init(&g_cpus[0], t);
+
+    // boot code is kernel code like any other: it holds the BKL until sched_idle
+    bkl_lock();
+}
+
+void sched_init_cpu(void) {
+    uint32_t me = cpu_id();
+    char name[] = "idle0";
+    name[4] = (char)('0' + me);
+
+    int slot;
+    thread_t* t = slot_alloc(name, &slot);
+    if (!t) panic("sched_init_cpu: thread table full");
+    t->state = THREAD_RUNNING;
+    t->cpu = me;
+    t->on_cpu = 1;
+    t->pinned = 1;
+    t->acct_tsc = now_tsc();
+    cpu_init(&g_cpus[me], t);
+}
+
+// cpu < 0: least loaded CPU, ties stay here; else pinned there
+static thread_t* spawn(const char* name, thread_fn fn, void* arg, struct proc* proc, int cpu) {
+    uint32_t f = irq_save();
+
+    int slot = 0;
+    thread_t* t = slot_alloc(name, &slot);
+    if (!t) {
+        irq_restore(f);
+        return 0;
+    }
+
+    t->fn = fn;
+    t->arg = arg;
+    t->proc = proc;
+    t->stack = g_stacks[slot];
+    *(uint32_t*)t->stack = THREAD_STACK_MAGIC;
+
+    // frame context_switch pops: edi esi ebx ebp eflags eip
+    uint32_t* sp = (uint32_t*)(t->stack + THREAD_STACK_SIZE);
+    *--sp = 0;                          // thread_start's return address, never used
+    *--sp = (uint32_t)thread_start;
+    *--sp = 0x002;                      // EFLAGS: IF=0 until thread_start
+    *--sp = 0;                          // ebp
+    *--sp = 0;                          // ebx
+    *--sp = 0;                          // esi
+    *--sp = 0;                          // edi
+    t->esp = (uint32_t)sp;
+
+    uint32_t best = cpu_id();
+    if (cpu >= 0) {
+        best = (uint32_t)cpu;
+        t->pinned = 1;
+    } else {
+        for (uint32_t i = 0; i < CPU_MAX; i++) {
+            if (g_cpus[i].online && cpu_load(&g_cpus[i]) < cpu_load(&g_cpus[best])) best = i;
+        }
+    }
+
+    sched_cpu_t* c = &g_cpus[best];
+    spin_lock(&c->lock);
+    t->cpu = best;
+    rq_push(c, t);
+    int kick = c->current == c->idle;
+    if (kick) c->need_resched = 1;
+    spin_unlock(&c->lock);
+    if (kick) smp_send_resched(best);
+
+    irq_restore(f);
+    return t;
+}
+
+thread_t* thread_create(const char* name, thread_fn fn, void* arg) {
+    return spawn(name, fn, arg, 0, -1);
+}
+
+thread_t* thread_spawn(const char* name, thread_fn fn, void* arg, struct proc* proc) {
+    return spawn(name, fn, arg, proc, -1);
+}
+
+thread_t* thread_create_on(const char* name, thread_fn fn, void* arg, uint32_t cpu) {
+    if (cpu >= CPU_MAX || !g_cpus[cpu].online) return 0;
+    return spawn(name, fn, arg, 0, (int)cpu);
+}
+
+void thread_yield(void) {
+    uint32_t f = irq_save();
+    if (this_cpu()->current) schedule();
+    irq_restore(f);
+}
+
+void thread_block(void) {
+    sched_cpu_t* c = this_cpu();
+    thread_t* t = c->current;
+    if (t == c->idle) panic("idle thread blocked");
+
+    // our queue lock is the one thread_wake takes for us
+    spin_lock(&c->lock);
+    if (t->wake_pending) {
+        t->wake_pending = 0;
+        spin_unlock(&c->lock);
+        return;
+    }
+    t->state = THREAD_BLOCKED;
+    spin_unlock(&c->lock);
+    // a wake from here on finds BLOCKED and queues us; schedule() copes
+    schedule();
+}
+
+void thread_wake(thread_t* t) {
+    uint32_t f = irq_save();
+    // t->cpu only changes under that CPU's lock (switch in, balancer), so
+    // once it reads the same with the lock held, it's the right lock
+    uint32_t cpu;
+    sched_cpu_t* c;
+    for (;;) {
+        cpu = t->cpu;
+        c = &g_cpus[cpu];
+        spin_lock(&c->lock);
+        if (t->cpu == cpu) break;
+        spin_unlock(&c->lock);
+    }
+    int kick = 0;
+
+    if (t->state == THREAD_BLOCKED) {
+        // gave the CPU up before its slice ran out: interactive, move up
+        if (t->level > 0) t->level--;
+        t->state = THREAD_READY;
+        rq_push(c, t);
+        if (c->current == c->idle || t->level < c->current->level) {
+            c->need_resched = 1;
+            kick = 1;
+        }
+    } else if (t->state == THREAD_RUNNING || t->state == THREAD_READY) {
+        t->wake_pending = 1;
+    }
+    spin_unlock(&c->lock);
+
+    if (kick) smp_send_resched(cpu);
+    irq_restore(f);
+}
+
+void thread_exit(void) {
+    __asm__ volatile ("cli");
+    sched_cpu_t* c = this_cpu();
+    if (!c->current->stack) panic("boot thread exited");
+
+    c->current->state = THREAD_DEAD;
+    schedule();
+    for (;;) __asm__ volatile ("hlt");  // not reached: DEAD threads are never resumed
+}
+
+int sched_can_block(void) {
+    uint32_t f = irq_save();
+    int ok = this_cpu()->idle != 0;
+    irq_restore(f);
+    return ok;
+}
+
+thread_t* thread_current(void) {
+    // with IRQs on we could move CPUs between the two reads
+    uint32_t f = irq_save();
+    thread_t* t = this_cpu()->current;
+    irq_restore(f);
+    return t;
+}
+
+const thread_t* thread_get(int i) {
+    if (i < 0 || i >= THREAD_MAX) return 0;
+    if (g_threads[i].state == THREAD_UNUSED) return 0;
+    return &g_threads[i];
+}
+
+void sched_idle(void) {
+    __asm__ volatile ("cli" ::: "memory");
+    sched_cpu_t* c = this_cpu();
+    c->idle = c->current;
+    // idle holds nothing; on the BSP this drops the BKL boot ran under
+    bkl_release_all();
+    for (;;) {
+        // schedule() comes back here only once every level is empty
+        if (c->rq_bitmap) schedule();
+        // sti;hlt is atomic: a wakeup can't slip in between the check and the hlt
+        __asm__ volatile ("sti; hlt; cli" ::: "memory");
+    }
+}
+
+void sched_tick(void) {
+    sched_cpu_t* c = this_cpu();
+    thread_t* cur = c->current;
+    if (!cur) return;
+    if (g_tsc) acct_charge(cur, rdtsc());
+    cur->ticks++;
+    c->ticks++;
+    if (cur == c->idle) c->idle_ticks++;
+    c->stats[cur->level].ticks++;
+
+    if (--c->boost_in == 0) {
+        c->boost_in = SCHED_BOOST_TICKS;
+        spin_lock(&c->lock);
+        boost_all(c);
+        spin_unlock(&c->lock);
+    }
+
+    if (--c->balance_in == 0) {
+        c->balance_in = SCHED_BALANCE_TICKS;
+        balance(c);
+    }
+
+    if (cur == c->idle) {
+        if (c->rq_bitmap) c->need_resched = 1;
+    } else if (c->slice && --c->slice == 0) {
+        c->need_resched = 1;
+        c->slice_expired = 1;
+    }
+}
+
+void sched_preempt(void) {
+    sched_cpu_t* c = this_cpu();
+    // A thread interrupted inside a BKL section keeps the CPU: switching
+    // would drop the lock under it. need_resched stays set, so the first
+    // IRQ exit after it lets go (or its next block/yield) switches.
+    if (bkl_held()) return;
+    if (c->current && c->need_resched) schedule();
+}
+
+void sched_acct_kernel_entry(void) {
+    thread_t* t = this_cpu()->current;
+    if (!t) return;
+    if (g_tsc) acct_charge(t, rdtsc());
+    t->in_user = 0;
+}
+
+void sched_acct_user_return(void) {
+    thread_t* t = this_cpu()->current;
+    if (!t) return;
+    if (g_tsc) acct_charge(t, rdtsc());
+    t->in_user = 1;
+}
+
+void sched_set_quantum(uint32_t ticks) {
+    if (ticks == 0) ticks = 1;
+    g_quantum = ticks;
+}
+
+uint32_t sched_quantum(void) {
+    return g_quantum;
+}
+
+int sched_level_stat(uint32_t level, sched_level_stat_t* out, uint32_t* queued) {
+    if (level >= SCHED_LEVELS) return -1;
+    memset(out, 0, sizeof(*out));
+    if (queued) *queued = 0;
+    for (uint32_t i = 0; i < CPU_MAX; i++) {
+        sched_cpu_t* c = &g_cpus[i];
+        if (!c->online) continue;
+        const sched_level_stat_t* s = &c->stats[level];
+        out->dispatches += s->dispatches;
+        out->demotions += s->demotions;
+        out->ticks += s->ticks;
+        out->wait_cycles += s->wait_cycles;
+        if (s->wait_max > out->wait_max) out->wait_max = s->wait_max;
+        if (queued) *queued += c->rq[level].len;
+    }
+    return 0;
+}
+
+int sched_cpu_stat(uint32_t cpu, sched_cpu_stat_t* out) {
+    if (cpu >= CPU_MAX || !g_cpus[cpu].online) return -1;
+    sched_cpu_t* c = &g_cpus[cpu];
+    out->online = 1;
+    out->current = c->current ? c->current->id : 0;
+    out->nr_ready = c->nr_ready;
+    out->migrations = c->migrations;
+    out->ticks = c->ticks;
+    out->idle_ticks = c->idle_ticks;
+    return 0;
+}
+
+void sched_stats_reset(void) {
+    uint32_t f = irq_save();
+    for (uint32_t i = 0; i < CPU_MAX; i++) {
+        memset(g_cpus[i].stats, 0, sizeof(g_cpus[i].stats));
+        g_cpus[i].migrations = 0;
+    }
+    irq_restore(f);
+}
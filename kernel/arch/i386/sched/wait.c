@@ -0,0 +1,159 @@
+// wait.c
+#include <stdint.h>
+#include <arch/i386/cpu.h>
+#include <arch/i386/spinlock.h>
+#include <arch/i386/thread.h>
+#include <arch/i386/timer.h>
+#include <arch/i386/wait.h>
+
+// Lock order: a queue's lock, then the run queue locks thread_wake takes.
+// Waiters only leave through wait_finish, which takes the queue lock and
+// cancels the timeout (waiting out a callback in flight), so an entry
+// found on a queue under its lock, or by its timer, is still alive.
+
+void wait_queue_init(wait_queue_t* q, const char* name) {
+    spin_init(&q->lock, name);
+}
+
+static void queue_append(wait_queue_t* q, wait_entry_t* e) {
+    e->next = 0;
+    if (q->tail) q->tail->next = e;
+    else q->head = e;
+    q->tail = e;
+    e->on_queue = 1;
+}
+
+static void queue_remove(wait_queue_t* q, wait_entry_t* e) {
+    wait_entry_t* prev = 0;
+    for (wait_entry_t* w = q->head; w; prev = w, w = w->next) {
+        if (w != e) continue;
+        if (prev) prev->next = e->next;
+        else q->head = e->next;
+        if (q->tail == e) q->tail = prev;
+        break;
+    }
+    e->next = 0;
+    e->on_queue = 0;
+}
+
+// timer wheel, IRQ0 context. Nothing of e is touched after timed_out is
+// published: the waiter may see it on another CPU and return. (timer_cancel
+// in wait_finish also waits this callback out; this doesn't depend on it.)
+static void wait_timeout(void* arg) {
+    wait_entry_t* e = (wait_entry_t*)arg;
+    struct thread* t = e->thread;
+    __asm__ volatile ("" ::: "memory");
+    e->timed_out = 1;
+    thread_wake(t);
+}
+
+void wait_prepare(wait_queue_t* q, wait_entry_t* e, uint32_t ticks) {
+    e->thread = thread_current();
+    e->queue = q;
+    e->next = 0;
+    e->on_queue = 0;
+    e->woken = e->timed_out = 0;
+    e->timed = ticks != 0;
+
+    if (q) {
+        spin_lock(&q->lock);
+        queue_append(q, e);
+        spin_unlock(&q->lock);
+    }
+    if (ticks) {
+        timer_setup(&e->timeout, wait_timeout, e, 0);
+        timer_add(&e->timeout, ticks);
+    }
+}
+
+// Until this CPU has an idle thread (boot, before sched_idle) there may be
+// nothing to switch to: wait for the next interrupt instead.
+static void block_once(void) {
+    if (sched_can_block()) thread_block();
+    else __asm__ volatile ("sti; hlt; cli" ::: "memory");
+}
+
+int wait_block(wait_entry_t* e) {
+    if (e->woken) {
+        // back on the queue before the caller looks at its condition again
+        wait_queue_t* q = e->queue;
+        spin_lock(&q->lock);
+        e->woken = 0;
+        queue_append(q, e);
+        spin_unlock(&q->lock);
+        return 1;
+    }
+    if (e->timed_out) return 0;
+    block_once();
+    return 1;
+}
+
+void wait_finish(wait_entry_t* e, int consumed) {
+    wait_queue_t* q = e->queue;
+    int pass_on = 0;
+    if (q) {
+        spin_lock(&q->lock);
+        if (e->on_queue) queue_remove(q, e);
+        // picked by a wake-one we aren't going to act on: someone else should
+        pass_on = e->woken && !consumed;
+        spin_unlock(&q->lock);
+    }
+    if (e->timed) timer_cancel(&e->timeout);
+    if (pass_on) wake_up(q);
+}
+
+void sleep_on(wait_queue_t* q) {
+    wait_entry_t e;
+    uint32_t f = irq_save();
+    wait_prepare(q, &e, 0);
+    while (!e.woken) block_once();
+    wait_finish(&e, 1);
+    irq_restore(f);
+}
+
+int sleep_on_timeout(wait_queue_t* q, uint32_t ticks) {
+    wait_entry_t e;
+    uint32_t f = irq_save();
+    wait_prepare(q, &e, ticks);
+    while (!e.woken && !e.timed_out) block_once();
+    int woken = e.woken;
+    wait_finish(&e, 1);
+    irq_restore(f);
+    return woken;
+}
+
+void thread_sleep(uint32_t ticks) {
+    if (!ticks) {
+        thread_yield();
+        return;
+    }
+    wait_entry_t e;
+    uint32_t f = irq_save();
+    wait_prepare(0, &e, ticks);
+    while (wait_block(&e)) {}
+    wait_finish(&e, 1);
+    irq_restore(f);
+}
+
+static int wake(wait_queue_t* q, int all) {
+    int n = 0;
+    uint32_t f = spin_lock_irqsave(&q->lock);
+    while (q->head) {
+        wait_entry_t* e = q->head;
+        queue_remove(q, e);
+        e->woken = 1;
+        thread_wake(e->thread);
+        n++;
+        if (!all) break;
+    }
+    spin_unlock_irqrestore(&q->lock, f);
+    return n;
+}
+
+int wake_up(wait_queue_t* q) {
+    return wake(q, 0);
+}
+
+int wake_up_all(wait_queue_t* q) {
+    return wake(q, 1);
+}
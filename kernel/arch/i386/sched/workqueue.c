@@ -0,0 +1,93 @@
+// workqueue.c
+#include <stdint.h>
+#include <string.h>
+#include <kernel/panic.h>
+#include <arch/i386/cpu.h>
+#include <arch/i386/thread.h>
+#include <arch/i386/workqueue.h>
+
+// LIFO of pending items, pushed with cmpxchg by any number of producers.
+// The single consumer takes the whole list in one xchg and reverses it,
+// so nobody ever waits on anybody and there is no ABA: an item is only
+// pushed again after kworker has taken it off.
+static work_t* volatile g_pending = 0;
+static thread_t* g_worker = 0;
+static workqueue_stat_t g_stat;
+static int g_tsc = 0;
+
+int work_queue(work_t* w) {
+    if (__atomic_exchange_n(&w->pending, 1u, __ATOMIC_ACQ_REL)) {
+        __atomic_fetch_add(&g_stat.merged, 1u, __ATOMIC_RELAXED);
+        return 0;
+    }
+    w->queued_tsc = g_tsc ? rdtsc() : 0;
+
+    work_t* head = __atomic_load_n(&g_pending, __ATOMIC_RELAXED);
+    do {
+        w->next = head;
+    } while (!__atomic_compare_exchange_n(&g_pending, &head, w, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    __atomic_fetch_add(&g_stat.queued, 1u, __ATOMIC_RELAXED);
+
+    if (g_worker) thread_wake(g_worker);
+    return 1;
+}
+
+static void run_one(work_t* w) {
+    if (g_tsc) {
+        uint64_t waited = rdtsc() - w->queued_tsc;
+        g_stat.wait_cycles += waited;
+        if (waited > g_stat.wait_max) g_stat.wait_max = waited;
+    }
+    g_stat.run++;
+
+    work_fn fn = w->fn;
+    void* arg = w->arg;
+    // cleared first, so the item can be queued again while it runs
+    __atomic_store_n(&w->pending, 0u, __ATOMIC_RELEASE);
+    fn(arg);
+}
+
+static void kworker_main(void* arg) {
+    (void)arg;
+    for (;;) {
+        work_t* list = __atomic_exchange_n(&g_pending, (work_t*)0, __ATOMIC_ACQUIRE);
+        if (!list) {
+            // a work_queue after the xchg either finds us BLOCKED or leaves
+            // wake_pending, so this can't sleep through new work
+            uint32_t f = irq_save();
+            thread_block();
+            irq_restore(f);
+            continue;
+        }
+
+        // pushed LIFO, run in the order they were queued
+        work_t* fifo = 0;
+        while (list) {
+            work_t* next = list->next;
+            list->next = fifo;
+            fifo = list;
+            list = next;
+        }
+        while (fifo) {
+            work_t* next = fifo->next;
+            run_one(fifo);
+            fifo = next;
+        }
+    }
+}
+
+void workqueue_init(void) {
+    g_tsc = (cpuid_edx(1) & CPUID_EDX_TSC) ? 1 : 0;
+    g_worker = thread_create_on("kworker", kworker_main, 0, 0);
+    if (!g_worker) panic("workqueue: no thread for kworker");
+}
+
+const workqueue_stat_t* workqueue_stat(void) {
+    return &g_stat;
+}
+
+void workqueue_stats_reset(void) {
+    uint32_t f = irq_save();
+    memset(&g_stat, 0, sizeof(g_stat));
+    irq_restore(f);
+}
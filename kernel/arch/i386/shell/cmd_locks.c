@@ -0,0 +1,22 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <arch/i386/spinlock.h>
+
+int cmd_locks(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "reset") == 0) {
+        spin_stats_reset();
+        printf("lock stats cleared\n");
+        return 0;
+    }
+
+    printf("%-14s %10s %10s %6s %12s %12s\n", "lock", "acquires", "contended", "cont%",
+           "avg spins", "max hold cyc");
+    for (spinlock_t* l = spin_lock_list(); l; l = l->list_next) {
+        uint32_t pct = l->acquires ? (uint32_t)((uint64_t)l->contended * 100 / l->acquires) : 0;
+        uint32_t avg = l->contended ? (uint32_t)(l->spins / l->contended) : 0;
+        printf("%-14s %10u %10u %5u%% %12u %12u\n", l->name, l->acquires, l->contended, pct, avg,
+               (uint32_t)l->hold_max);
+    }
+    return 0;
+}
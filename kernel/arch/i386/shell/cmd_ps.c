@@ -0,0 +1,24 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <arch/i386/proc.h>
+
+static const char* proc_state_name(const proc_t* p) {
+    if (p->state == PROC_LOADING) return "loading";
+    if (!p->thread) return "?";
+    return p->thread->state == THREAD_RUNNING ? "running" : "ready";
+}
+
+int cmd_ps(int argc, char** argv) {
+    (void)argc; (void)argv;
+
+    printf("%-5s %-8s %8s %8s %10s  %s\n", "pid", "state", "heap KB", "vm pg", "ticks", "name");
+    for (int i = 0; i < PROC_MAX; i++) {
+        const proc_t* p = proc_get(i);
+        if (!p) continue;
+        uint32_t heap_kb = (p->uvm.brk - UVM_HEAP_BASE) / 1024;
+        uint32_t ticks = p->thread ? (uint32_t)p->thread->ticks : 0;
+        printf("%-5u %-8s %8u %8u %10u  %s\n", p->pid, proc_state_name(p), heap_kb,
+               p->uvm.resident, ticks, p->name);
+    }
+    return 0;
+}
@@ -0,0 +1,28 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <arch/i386/syscall.h>
+
+int cmd_sysstat(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "reset") == 0) {
+        syscall_stats_reset();
+        printf("syscall stats cleared\n");
+        return 0;
+    }
+
+    printf("%-3s %-10s %10s %10s  hist (<128,<256,... cycles)\n", "nr", "name", "calls", "avg cyc");
+    for (uint32_t n = 0; n < SYSCALL_MAX; n++) {
+        const syscall_stat_t* s = syscall_stat(n);
+        if (!s) continue;
+
+        uint32_t avg = s->calls ? (uint32_t)(s->cycles / s->calls) : 0;
+        printf("%-3u %-10s %10u %10u ", n, syscall_name(n), s->calls, avg);
+
+        // trim trailing empty buckets
+        int last = SYSCALL_HIST_BUCKETS - 1;
+        while (last > 0 && !s->hist[last]) last--;
+        for (int b = 0; b <= last; b++) printf(" %u", s->hist[b]);
+        printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,95 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <arch/i386/thread.h>
+#include <arch/i386/smp.h>
+#include <arch/i386/workqueue.h>
+
+static const char* state_name(thread_state_t s) {
+    switch (s) {
+    case THREAD_READY:   return "ready";
+    case THREAD_RUNNING: return "running";
+    case THREAD_BLOCKED: return "blocked";
+    case THREAD_DEAD:    return "dead";
+    default:             return "?";
+    }
+}
+
+static uint32_t parse_u32(const char* s) {
+    uint32_t v = 0;
+    while (*s >= '0' && *s <= '9') v = v * 10 + (uint32_t)(*s++ - '0');
+    return v;
+}
+
+static void print_levels(void) {
+    printf("%-3s %6s %10s %8s %8s %12s %12s\n", "lvl", "queued", "dispatch", "demoted", "ticks",
+           "avg wait cyc", "max wait cyc");
+    for (uint32_t l = 0; l < SCHED_LEVELS; l++) {
+        uint32_t queued = 0;
+        sched_level_stat_t s;
+        sched_level_stat(l, &s, &queued);
+        uint32_t avg = s.dispatches ? (uint32_t)(s.wait_cycles / s.dispatches) : 0;
+        printf("%-3u %6u %10u %8u %8u %12u %12u\n", l, queued, s.dispatches, s.demotions,
+               s.ticks, avg, (uint32_t)s.wait_max);
+    }
+}
+
+static void print_cpus(void) {
+    printf("%-4s %4s %8s %6s %10s %6s\n", "cpu", "apic", "running", "queued", "migrated", "idle%");
+    for (uint32_t i = 0; i < CPU_MAX; i++) {
+        sched_cpu_stat_t c;
+        if (sched_cpu_stat(i, &c) < 0) continue;
+        uint32_t idle = c.ticks ? (uint32_t)(c.idle_ticks * 100 / c.ticks) : 0;
+        printf("%-4u %4u %8u %6u %10u %5u%%\n", i, smp_apic_id(i), c.current, c.nr_ready,
+               c.migrations, idle);
+    }
+    printf("balance every %u ticks\n", (uint32_t)SCHED_BALANCE_TICKS);
+}
+
+static void print_work(void) {
+    const workqueue_stat_t* w = workqueue_stat();
+    uint32_t avg = w->run ? (uint32_t)(w->wait_cycles / w->run) : 0;
+    printf("kworker: queued=%u merged=%u run=%u avg wait=%u cyc max=%u cyc\n", w->queued,
+           w->merged, w->run, avg, (uint32_t)w->wait_max);
+}
+
+int cmd_threads(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "quantum") == 0) {
+        if (argc > 2) sched_set_quantum(parse_u32(argv[2]));
+        printf("quantum=%u ticks\n", sched_quantum());
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "cpus") == 0) {
+        print_cpus();
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "work") == 0) {
+        if (argc > 2 && strcmp(argv[2], "reset") == 0) {
+            workqueue_stats_reset();
+            printf("work queue stats cleared\n");
+            return 0;
+        }
+        print_work();
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "levels") == 0) {
+        if (argc > 2 && strcmp(argv[2], "reset") == 0) {
+            sched_stats_reset();
+            printf("scheduler stats cleared\n");
+            return 0;
+        }
+        print_levels();
+        return 0;
+    }
+
+    printf("%-4s %-16s %-8s %3s %3s %10s %10s\n", "id", "name", "state", "cpu", "lvl", "switches", "ticks");
+    for (int i = 0; i < THREAD_MAX; i++) {
+        const thread_t* t = thread_get(i);
+        if (!t) continue;
+        printf("%-4u %-16s %-8s %3u %3u %10u %10u\n", t->id, t->name, state_name(t->state),
+               t->cpu, t->level, t->switches, (uint32_t)t->ticks);
+    }
+    printf("quantum=%u ticks (level n: n+1 quanta), boost every %u ticks\n",
+           sched_quantum(), (uint32_t)SCHED_BOOST_TICKS);
+    return 0;
+}
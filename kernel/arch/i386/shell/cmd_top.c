@@ -0,0 +1,149 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <kernel/tty.h>
+#include <arch/i386/cpu.h>
+#include <arch/i386/thread.h>
+#include <arch/i386/proc.h>
+#include <arch/i386/smp.h>
+#include <arch/i386/timer.h>
+#include <arch/i386/wait.h>
+
+// `top` runs on its own thread, so kworker (and with it the keyboard and
+// the shell) stays free while it refreshes: `top stop` ends it early.
+#define TOP_ROWS           16
+#define TOP_FRAMES_DEFAULT 10u
+#define TOP_DELAY_DEFAULT  100u     // ticks between frames
+
+typedef struct {
+    const thread_t* t;
+    uint32_t pct10;                 // %CPU over the last interval, x10
+} top_row_t;
+
+static thread_t* g_top = 0;
+static volatile int g_top_stop = 0;
+static uint32_t g_frames, g_delay;
+
+// cycles each slot had at the previous frame; id tells a reused slot apart
+static uint32_t g_prev_id[THREAD_MAX];
+static uint64_t g_prev_cyc[THREAD_MAX];
+
+static uint32_t parse_u32(const char* s) {
+    uint32_t v = 0;
+    while (*s >= '0' && *s <= '9') v = v * 10 + (uint32_t)(*s++ - '0');
+    return v;
+}
+
+static uint32_t cyc_to_ms(uint64_t cyc) {
+    uint64_t per_tick = timer_tsc_per_tick();
+    uint32_t hz = timer_hz();
+    if (!per_tick || !hz) return 0;
+    return (uint32_t)(cyc * 1000 / (per_tick * hz));
+}
+
+static void snapshot(void) {
+    for (int i = 0; i < THREAD_MAX; i++) {
+        const thread_t* t = thread_get(i);
+        g_prev_id[i] = t ? t->id : 0;
+        g_prev_cyc[i] = t ? t->utime + t->stime : 0;
+    }
+}
+
+static void frame(uint64_t elapsed) {
+    top_row_t rows[THREAD_MAX];
+    int n = 0;
+
+    for (int i = 0; i < THREAD_MAX; i++) {
+        const thread_t* t = thread_get(i);
+        if (!t || t->state == THREAD_DEAD) continue;
+        uint64_t cyc = t->utime + t->stime;
+        uint64_t d = (g_prev_id[i] == t->id && cyc >= g_prev_cyc[i]) ? cyc - g_prev_cyc[i] : 0;
+        rows[n].t = t;
+        rows[n].pct10 = elapsed ? (uint32_t)(d * 1000 / elapsed) : 0;    // of one CPU
+        n++;
+    }
+
+    // most CPU first; insertion sort, n <= THREAD_MAX
+    for (int i = 1; i < n; i++) {
+        top_row_t r = rows[i];
+        int j = i - 1;
+        while (j >= 0 && rows[j].pct10 < r.pct10) {
+            rows[j + 1] = rows[j];
+            j--;
+        }
+        rows[j + 1] = r;
+    }
+
+    uint32_t hz = timer_hz();
+    uint32_t up = hz ? (uint32_t)(timer_ticks() / hz) : 0;
+    uint32_t procs = 0, rss = 0;
+    for (int i = 0; i < PROC_MAX; i++) {
+        const proc_t* p = proc_get(i);
+        if (!p) continue;
+        procs++;
+        rss += proc_resident_frames(p);
+    }
+
+    terminal_initialize();
+    printf("top - up %u s, %u CPU%s, %d threads, %u procs, %u KB user resident\n", up,
+           smp_cpu_count(), smp_cpu_count() == 1 ? "" : "s", n, procs, rss * 4);
+    printf("%-4s %-4s %-3s %-7s %6s %8s %8s %6s %6s %7s %s\n", "tid", "pid", "cpu", "state",
+           "%cpu", "user ms", "sys ms", "rss KB", "faults", "sysc", "name");
+    for (int i = 0; i < n && i < TOP_ROWS; i++) {
+        const thread_t* t = rows[i].t;
+        const proc_t* p = t->proc;
+        const char* st = t->state == THREAD_RUNNING ? "running"
+                       : t->state == THREAD_READY ? "ready" : "blocked";
+        printf("%-4u ", t->id);
+        if (p) printf("%-4u ", p->pid);
+        else printf("%-4s ", "-");
+        printf("%-3u %-7s %4u.%u %8u %8u ", t->cpu, st, rows[i].pct10 / 10, rows[i].pct10 % 10,
+               cyc_to_ms(t->utime), cyc_to_ms(t->stime));
+        if (p) printf("%6u %6u %7u ", proc_resident_frames(p) * 4, p->faults, p->syscalls);
+        else printf("%6s %6s %7s ", "-", "-", "-");
+        printf("%s\n", t->name);
+    }
+}
+
+static void top_main(void* arg) {
+    (void)arg;
+    snapshot();
+    uint64_t last = rdtsc();
+    for (uint32_t f = 0; f < g_frames && !g_top_stop; f++) {
+        thread_sleep(g_delay);
+        uint64_t now = rdtsc();
+        frame(now - last);
+        snapshot();
+        last = now;
+    }
+    printf("top: done\n");
+    g_top = 0;
+}
+
+int cmd_top(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "stop") == 0) {
+        if (g_top) g_top_stop = 1;
+        return 0;
+    }
+    if (!(cpuid_edx(1) & CPUID_EDX_TSC) || !timer_tsc_per_tick()) {
+        printf("top: needs a calibrated TSC\n");
+        return -1;
+    }
+    if (g_top) {
+        printf("top: already running ('top stop' ends it)\n");
+        return -1;
+    }
+
+    g_frames = argc > 1 ? parse_u32(argv[1]) : TOP_FRAMES_DEFAULT;
+    g_delay = argc > 2 ? parse_u32(argv[2]) : TOP_DELAY_DEFAULT;
+    if (!g_frames) g_frames = TOP_FRAMES_DEFAULT;
+    if (!g_delay) g_delay = 1;
+    g_top_stop = 0;
+
+    g_top = thread_create("top", top_main, 0);
+    if (!g_top) {
+        printf("top: no free thread\n");
+        return -1;
+    }
+    return 0;
+}
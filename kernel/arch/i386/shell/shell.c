@@ -6,18 +6,20 @@
 #include <kernel/tty.h>
 #include <kernel/user_exec.h>
 #include <arch/i386/keyboard.h>
-#include <arch/i386/user_bouncing.h>
 #include <arch/i386/isr.h>
 #include <arch/i386/portio.h>
 #include <arch/i386/paging.h>
+#include <arch/i386/timer.h>
+#include <arch/i386/thread.h>
 
-extern volatile uint32_t g_exec_kcr3;
-
-// If you have timer ticks exported:
-extern uint32_t timer_ticks(void);
 // Shell commands implemented in /shell
 int cmd_mem(int argc, char** argv);
 int cmd_alloc(int argc, char** argv);
+int cmd_sysstat(int argc, char** argv);
+int cmd_threads(int argc, char** argv);
+int cmd_ps(int argc, char** argv);
+int cmd_locks(int argc, char** argv);
+int cmd_top(int argc, char** argv);
 void initrd_ls(void);
 int  initrd_cat(const char* path);
 // Optional: to debug pmm pages
@@ -25,14 +27,6 @@ int  initrd_cat(const char* path);
 extern void keyboard_enable_shell(bool enable);
 extern void keyboard_irq(regs_t* r);
 
-extern void irq_install_handler(int irq, void (*fn)(regs_t*));
-static void irq1_scream(regs_t* r) { (void)r; putchar('K'); }
-
-static inline uint32_t read_cr3(void) {
-    uint32_t val;
-    __asm__ volatile("mov %%cr3, %0" : "=r"(val));
-    return val;
-}
 
 #define SHELL_MAX_PATH 256
 static char g_cwd[SHELL_MAX_PATH] = "/";
@@ -66,6 +60,11 @@ static const cmd_t cmds[] = {
     { "uptime",  cmd_uptime },
     { "mem",     cmd_mem },
     { "alloc",   cmd_alloc },
+    { "sysstat", cmd_sysstat },
+    { "threads", cmd_threads },
+    { "ps",      cmd_ps },
+    { "locks",   cmd_locks },
+    { "top",     cmd_top },
     { "pwd",     cmd_pwd },
     { "cd",      cmd_cd },
     { "ls",      cmd_ls },
@@ -213,14 +212,23 @@ static int cmd_help(int argc, char** argv) {
     printf("  help            - show this\n");
     printf("  clear           - clear screen\n");
     printf("  echo <text...>  - print text\n");
-    printf("  ticks           - show timer ticks\n");
+    printf("  ticks           - show timer ticks and timer wheel stats\n");
     printf("  mem             - show physical memory stats\n");
     printf("  alloc <bytes>   - kmalloc test\n");
+    printf("  sysstat [reset] - syscall counts + latency\n");
+    printf("  threads [quantum <n>] - list kernel threads, set time slice\n");
+    printf("  threads levels [reset] - per-level scheduler stats\n");
+    printf("  threads cpus           - per-CPU load, migrations, idle time\n");
+    printf("  threads work [reset]   - deferred work queue stats\n");
+    printf("  ps              - list user processes\n");
+    printf("  locks [reset]   - spinlock acquires, contention, max hold\n");
+    printf("  top [frames] [ticks] | stop - CPU time, memory, faults per thread\n");
     printf("  pwd             - print cwd\n");
     printf("  cd [path]       - change directory\n");
     printf("  ls [path]       - list directory\n");
     printf("  cat <path>      - print file\n");
     printf("  hexdump <path>  - dump bytes\n");
+    printf("  exec <path>     - start a user program in the background\n");
     printf("  panic           - trigger crash\n");
     return 0;
 }
@@ -234,7 +242,13 @@ static int cmd_clear(int argc, char** argv) {
 static int cmd_ticks(int argc, char** argv) { 
     (void)argc;
     (void)argv; 
-    printf("ticks=%u\n", timer_ticks()); 
+    printf("ticks=%llu\n", timer_ticks()); 
+
+    timer_wheel_stat_t w;
+    timer_wheel_stat(&w);
+    printf("timers: pending %u/%u/%u/%u by level, added=%u fired=%u cancelled=%u cascaded=%u\n",
+           w.pending[0], w.pending[1], w.pending[2], w.pending[3], w.added, w.fired,
+           w.cancelled, w.cascaded);
     return 0; 
 }
 static int cmd_panic(int argc, char** argv) { 
@@ -246,9 +260,9 @@ static int cmd_panic(int argc, char** argv) {
 
 static int cmd_uptime(int argc, char** argv) {
     (void)argc; (void)argv;
-    uint32_t t = timer_ticks();
-    // if your PIT is 100Hz, seconds = ticks/100
-    uint32_t sec = t / 100;
+    uint64_t t = timer_ticks();
+    uint32_t hz = timer_hz();
+    uint32_t sec = hz ? (uint32_t)(t / hz) : 0;
     printf("uptime=%u s\n", sec);
     return 0;
 }
@@ -363,15 +377,14 @@ static int cmd_exec(int argc, char** argv) {
     char path[256];
     shell_canon_path(path, g_cwd, argv[1]);
 
-    if (user_exec(path) < 0) {
+    // runs alongside the shell; its exit is reported when it happens
+    int pid = user_exec(path);
+    if (pid < 0) {
         printf("exec: failed: %s\n", path);
         return -1;
     }
-    keyboard_enable_shell(true);
-    printf("\n");
-    printf("FINISHED\n");
-    shell_prompt_public();
-    return 0; // never reached on success
+    printf("[pid %d] %s\n", pid, path);
+    return 0;
 }
 
 void shell_init(void) {
@@ -380,7 +393,7 @@ void shell_init(void) {
     shell_prompt();
 }
 
-// called by keyboard.c on Enter
+// called by keyboard.c on Enter, from kworker (IRQs on, preemptible)
 void shell_on_line(const char* line_in) {
     printf("\n");
 
@@ -416,23 +429,3 @@ void shell_on_line(const char* line_in) {
 
     shell_prompt();
 }
-
-__attribute__((noreturn))
-void exec_return_to_shell(void) {
-    printf("cr3=%x (saved kcr3=%x)\n", read_cr3(), g_exec_kcr3);
-    ps2_enable_irq1_only();
-    pic_unmask_irq1();
-    keyboard_enable_shell(true);
-    printf("\n");
-    shell_prompt_public();
-
-    irq_install_handler(1, irq1_scream);
-    __asm__ volatile("sti");          // <<< ADD THIS
-    for (;;) {
-        //if (inb(0x64) & 1) {      // output buffer full
-            //uint8_t sc = inb(0x60);
-            //printf("{%x}", sc);
-        //}
-        __asm__ volatile("hlt");
-    }
-}
\ No newline at end of file
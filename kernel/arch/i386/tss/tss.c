@@ -1,6 +1,8 @@
 #include <stdint.h>
+#include <stddef.h>
 #include <string.h>
 #include <arch/i386/tss.h>
+#include <arch/i386/smp.h>
 
 // 32-bit TSS (only fields we care about + padding)
 typedef struct __attribute__((packed)) tss_entry {
@@ -28,28 +30,32 @@ typedef struct __attribute__((packed)) tss_entry {
     uint16_t iomap_base;
 } tss_entry_t;
 
-static tss_entry_t g_tss;
-
-extern void tss_flush(uint16_t tss_sel);
-
-// provided by gdt.c
-extern void gdt_set_tss(uint32_t base, uint32_t limit, uint8_t access, uint8_t gran);
+// one per CPU: esp0 is where ring 3 -> 0 transitions land on that CPU
+static tss_entry_t g_tss[CPU_MAX] __attribute__((aligned(4)));
 
 void tss_set_kernel_stack(uint32_t esp0) {
-    g_tss.esp0 = esp0;
+    g_tss[cpu_id()].esp0 = esp0;
 }
 
-void tss_init(void) {
-    memset(&g_tss, 0, sizeof(g_tss));
+uint32_t* tss_kernel_stack_slot(void) {
+    // esp0 sits at offset 4 of a 4-aligned struct, packed or not
+    return (uint32_t*)((uint8_t*)&g_tss[cpu_id()] + offsetof(tss_entry_t, esp0));
+}
 
-    g_tss.ss0 = 0x10;                // kernel data selector
-    g_tss.iomap_base = sizeof(g_tss); // disable I/O bitmap
+void tss_init_cpu(uint32_t cpu) {
+    tss_entry_t* tss = &g_tss[cpu];
+    memset(tss, 0, sizeof(*tss));
 
-    // install TSS descriptor into GDT (we’ll put it at index 5)
-    gdt_set_tss((uint32_t)&g_tss, sizeof(g_tss) - 1, 0x89, 0x00);
+    tss->ss0 = 0x10;                 // kernel data selector
+    tss->iomap_base = sizeof(*tss);  // disable I/O bitmap
+
+    // install TSS descriptor into this CPU's GDT at index 5+cpu
+    gdt_set_tss(cpu, (uint32_t)tss, sizeof(*tss) - 1, 0x89, 0x00);
     // access 0x89 = present, ring0, type=32-bit available TSS
 
-    // load task register with selector for GDT entry 5
-    // selector = index*8 = 5*8 = 0x28
-    // tss_flush();
+    // caller loads the task register: tss_flush(GDT_TSS_SEL(cpu))
+}
+
+void tss_init(void) {
+    tss_init_cpu(0);
 }
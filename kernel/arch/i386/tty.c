@@ -7,30 +7,37 @@
 
 #include "vga.h"
 
-static const size_t VGA_WIDTH = 80;
-static const size_t VGA_HEIGHT = 25;
+#define VGA_WIDTH  ((size_t)TERMINAL_WIDTH)
+#define VGA_HEIGHT ((size_t)TERMINAL_HEIGHT)
 static uint16_t* const VGA_MEMORY = (uint16_t*) 0xB8000;
 
+// Usable before terminal_initialize: early boot and vga_print land here too.
 static size_t terminal_row;
 static size_t terminal_column;
-static uint8_t terminal_color;
-static uint16_t* terminal_buffer;
+static uint8_t terminal_color = VGA_COLOR_LIGHT_GREY | VGA_COLOR_BLACK << 4;
+static uint16_t* terminal_buffer = VGA_MEMORY;
+
+// RAM copy of the screen. VGA memory is mapped write-combining, so reading it
+// back (scrolling) is slow; keep reads here and only ever write to VGA.
+// This file is the only writer of VGA memory.
+static uint16_t terminal_shadow[VGA_WIDTH * VGA_HEIGHT];
 
 static void terminal_scroll(void) {
     // Move rows 1..24 up to 0..23
-    for (size_t y = 1; y < VGA_HEIGHT; y++) {
-        for (size_t x = 0; x < VGA_WIDTH; x++) {
-            terminal_buffer[(y - 1) * VGA_WIDTH + x] =
-                terminal_buffer[y * VGA_WIDTH + x];
-        }
-    }
+    memmove(terminal_shadow, terminal_shadow + VGA_WIDTH,
+            (VGA_HEIGHT - 1) * VGA_WIDTH * sizeof(uint16_t));
 
     // Clear last row
     for (size_t x = 0; x < VGA_WIDTH; x++) {
-        terminal_buffer[(VGA_HEIGHT - 1) * VGA_WIDTH + x] =
+        terminal_shadow[(VGA_HEIGHT - 1) * VGA_WIDTH + x] =
             vga_entry(' ', terminal_color);
     }
 
+    // one streaming pass over the screen, combines into burst writes
+    for (size_t i = 0; i < VGA_WIDTH * VGA_HEIGHT; i++) {
+        terminal_buffer[i] = terminal_shadow[i];
+    }
+
     terminal_row = VGA_HEIGHT - 1;
     terminal_column = 0;
 }
@@ -43,7 +50,8 @@ void terminal_initialize(void) {
 	for (size_t y = 0; y < VGA_HEIGHT; y++) {
 		for (size_t x = 0; x < VGA_WIDTH; x++) {
 			const size_t index = y * VGA_WIDTH + x;
-			terminal_buffer[index] = vga_entry(' ', terminal_color);
+			terminal_shadow[index] = vga_entry(' ', terminal_color);
+			terminal_buffer[index] = terminal_shadow[index];
 		}
 	}
 }
@@ -53,8 +61,10 @@ void terminal_setcolor(uint8_t color) {
 }
 
 void terminal_putentryat(unsigned char c, uint8_t color, size_t x, size_t y) {
+	if (x >= VGA_WIDTH || y >= VGA_HEIGHT) return;
 	const size_t index = y * VGA_WIDTH + x;
-	terminal_buffer[index] = vga_entry(c, color);
+	terminal_shadow[index] = vga_entry(c, color);
+	terminal_buffer[index] = terminal_shadow[index];
 }
 
 void terminal_putchar(char c) {
@@ -0,0 +1,55 @@
+// cpu.h
+#pragma once
+#include <stdint.h>
+
+// CPUID.1:EDX feature bits
+#define CPUID_EDX_FPU (1u << 0)
+#define CPUID_EDX_TSC (1u << 4)
+#define CPUID_EDX_MSR (1u << 5)
+#define CPUID_EDX_SEP (1u << 11)
+#define CPUID_EDX_PAT (1u << 16)
+#define CPUID_EDX_FXSR (1u << 24)
+#define CPUID_EDX_SSE (1u << 25)
+
+#define MSR_IA32_PAT 0x277u
+
+#define MSR_IA32_SYSENTER_CS  0x174u
+#define MSR_IA32_SYSENTER_ESP 0x175u
+#define MSR_IA32_SYSENTER_EIP 0x176u
+
+static inline void cpuid(uint32_t leaf, uint32_t* a, uint32_t* b, uint32_t* c, uint32_t* d) {
+    __asm__ volatile ("cpuid" : "=a"(*a), "=b"(*b), "=c"(*c), "=d"(*d) : "a"(leaf), "c"(0));
+}
+
+static inline uint32_t cpuid_edx(uint32_t leaf) {
+    uint32_t a, b, c, d;
+    cpuid(leaf, &a, &b, &c, &d);
+    return d;
+}
+
+static inline uint64_t rdmsr(uint32_t msr) {
+    uint32_t lo, hi;
+    __asm__ volatile ("rdmsr" : "=a"(lo), "=d"(hi) : "c"(msr));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+static inline void wrmsr(uint32_t msr, uint64_t v) {
+    __asm__ volatile ("wrmsr" : : "c"(msr), "a"((uint32_t)v), "d"((uint32_t)(v >> 32)));
+}
+
+static inline uint64_t rdtsc(void) {
+    uint32_t lo, hi;
+    __asm__ volatile ("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+// cli, returning the previous EFLAGS so irq_restore can put IF back
+static inline uint32_t irq_save(void) {
+    uint32_t f;
+    __asm__ volatile ("pushfl; popl %0; cli" : "=r"(f) :: "memory");
+    return f;
+}
+
+static inline void irq_restore(uint32_t f) {
+    if (f & 0x200) __asm__ volatile ("sti" ::: "memory");
+}
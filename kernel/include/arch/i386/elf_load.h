@@ -0,0 +1,16 @@
+#pragma once
+#include <stdint.h>
+#include <kernel/elf_cache.h>
+#include <arch/i386/paging.h>
+
+typedef struct {
+    uint32_t entry;
+    uint32_t user_stack_top;
+    uint32_t frames;            // pages mapped, stack included
+    const elf_cache_entry_t* cache; // shared frames mapped from here, or 0
+} user_image_t;
+
+// Map an ELF's PT_LOAD segments and a user stack into 'dir'. Headers and
+// segment bytes are read positionally, so there is no file size limit.
+// A nonzero out->cache holds a reference: elf_cache_put it with 'dir'.
+int elf_load_from_vfs(const char* path, page_directory_t dir, user_image_t* out);
@@ -0,0 +1,29 @@
+// fpu.h
+#pragma once
+#include <stdint.h>
+
+// x87/SSE state, switched lazily. CR0.TS is set on every context switch, so
+// the first FPU/SSE instruction a thread runs afterwards traps (#NM, vector
+// 7) and only then is its saved state loaded. A thread that used the FPU is
+// saved when it is switched away; one that didn't costs nothing either way.
+// If it comes back to the same CPU and nobody else touched the registers
+// meanwhile, the trap doesn't even reload them.
+
+#define FPU_STATE_SIZE 512u         // FXSAVE area, 16-byte aligned
+
+struct thread;
+
+// BSP: enable the FPU and SSE (CR0.EM off, MP/NE/TS on, CR4.OSFXSR and
+// OSXMMEXCPT) and take the clean state new threads start from. Needs FXSR;
+// without it the FPU stays off and #NM stays fatal.
+void fpu_init(void);
+// AP bring-up: same CR0/CR4 setup on this CPU, quietly
+void fpu_init_cpu(void);
+int  fpu_enabled(void);
+
+// New thread slot: no state yet, nothing cached in any CPU's registers
+void fpu_thread_init(struct thread* t);
+// schedule(), IRQs off, before switching away from 'prev' on this CPU
+void fpu_switch_out(struct thread* prev);
+// #NM: 1 if handled (the faulting instruction just reruns), 0 if the FPU is off
+int  fpu_trap(void);
@@ -2,8 +2,14 @@
 #include <stdint.h>
 
 void gdt_init(void);
+// Each CPU gets its own copy of the table, TSS slot included
+void gdt_init_cpu(uint32_t cpu);
+void gdt_set_tss(uint32_t cpu, uint32_t base, uint32_t limit, uint8_t access, uint8_t gran);
 
 #define KERNEL_CS 0x08
 #define KERNEL_DS 0x10
 #define USER_CS   0x1B
 #define USER_DS   0x23
+
+// CPU n's TSS lives at GDT index 5+n
+#define GDT_TSS_SEL(cpu) (0x28u + 8u * (uint32_t)(cpu))
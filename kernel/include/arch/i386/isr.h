@@ -17,6 +17,8 @@ typedef void (*isr_t)(regs_t*);
 void isr_handler(regs_t* r);
 void irq_handler(regs_t* r);
 
+// Once at boot, before the first irq_install_handler
+void irq_init(void);
 // Install/uninstall an IRQ handler by IRQ line number (0..15):
 // 0=timer, 1=keyboard, ...
 void irq_install_handler(int irq, isr_t handler);
@@ -0,0 +1,28 @@
+// lapic.h
+#pragma once
+#include <stdint.h>
+
+// Local APIC vectors, above the PIC's 32..47
+#define LAPIC_VEC_TIMER    0x40
+#define LAPIC_VEC_RESCHED  0x41
+#define LAPIC_VEC_SPURIOUS 0xFF
+
+// BSP: find the APIC, map its registers and enable it in virtual-wire mode
+// so the 8259 keeps delivering IRQs. 0 if there's no APIC.
+int  lapic_init(void);
+// AP: enable this CPU's APIC with LINT0/1 masked (PIC IRQs stay on the BSP)
+void lapic_init_ap(void);
+int  lapic_present(void);
+uint32_t lapic_id(void);
+void lapic_eoi(void);
+
+// Fixed IPI to one CPU by APIC id
+void lapic_send_ipi(uint32_t apic_id, uint8_t vector);
+// AP startup, broadcast to all-but-self
+void lapic_send_init_all(void);
+void lapic_send_sipi_all(uint8_t page);
+
+// BSP, PIT ticking: count APIC timer ticks per PIT tick. Then
+// lapic_timer_start() on each AP gives it a periodic tick at the PIT rate.
+void lapic_timer_calibrate(void);
+void lapic_timer_start(void);
@@ -8,6 +8,10 @@
 #define MULTIBOOT1_INFO_CMDLINE (1u << 2)
 #define MULTIBOOT1_INFO_MODS    (1u << 3)
 #define MULTIBOOT1_INFO_MMAP    (1u << 6)
+#define MULTIBOOT1_INFO_FRAMEBUFFER (1u << 12)
+
+#define MULTIBOOT1_FB_TYPE_RGB  1u
+#define MULTIBOOT1_FB_TYPE_TEXT 2u
 
 /* mmap entry (MUST be packed) */
 typedef struct multiboot_mmap_entry {
@@ -56,6 +60,27 @@ typedef struct multiboot_info {
 
     uint32_t mmap_length;
     uint32_t mmap_addr;
+
+    uint32_t drives_length;
+    uint32_t drives_addr;
+    uint32_t config_table;
+    uint32_t boot_loader_name;
+    uint32_t apm_table;
+
+    uint32_t vbe_control_info;
+    uint32_t vbe_mode_info;
+    uint16_t vbe_mode;
+    uint16_t vbe_interface_seg;
+    uint16_t vbe_interface_off;
+    uint16_t vbe_interface_len;
+
+    /* valid if flags & MULTIBOOT1_INFO_FRAMEBUFFER */
+    uint64_t framebuffer_addr;
+    uint32_t framebuffer_pitch;
+    uint32_t framebuffer_width;
+    uint32_t framebuffer_height;
+    uint8_t  framebuffer_bpp;
+    uint8_t  framebuffer_type;
 } multiboot_info_t;
 
 /* helpers */
@@ -6,6 +6,16 @@
 #define P_PRESENT 0x001u
 #define P_RW      0x002u
 #define P_USER    0x004u
+#define P_PWT     0x008u
+#define P_PCD     0x010u
+
+// OS-available PTE bit: frame is borrowed (initrd, shared text, ...) and must
+// not be returned to the PMM when the mapping goes away.
+#define P_SHARED  0x200u
+
+// Write-combining: PAT entry 1 (PWT only) is reprogrammed to WC by pat_init().
+// Dropped silently by paging_map*() when PAT isn't available.
+#define P_WC      P_PWT
 
 #define PAGE_SIZE 0x1000u
 #define PDE_COUNT 1024u
@@ -15,6 +25,17 @@
 #define KERNEL_ID_MAP_MB 256u
 #define KERNEL_PDE_END   (KERNEL_ID_MAP_MB / 4u)  // 4MB per PDE
 
+// PDEs from here up (>= 3GB) are kernel-only and shared by every directory,
+// like the identity map. Map MMIO here at boot, before any clone.
+#define KERNEL_HIGH_PDE_START 768u
+
+// Fixmap: kernel VAs inside the identity map that get remapped on the fly.
+// Their identity frames are reserved in the PMM so nothing relies on them.
+#define FIXMAP_START 0x00F00000u
+#define FIXMAP_END   0x01000000u
+#define KMAP_VA      0x00FE0000u   // paging_kmap() slots: KMAP_SLOTS pages per CPU,
+#define KMAP_SLOTS   4u            // CPU 0's first, up to FIXMAP_END
+
 typedef struct page_directory {
     uint32_t* pd_phys;   // physical address of page directory
     uint32_t* pd_virt;   // virtual pointer to same thing (identity mapped for now)
@@ -28,13 +49,35 @@ int  paging_unmap(uint32_t vaddr);
 uint32_t paging_translate(uint32_t vaddr);
 int  paging_alloc_map(uint32_t vaddr, uint32_t flags);
 
+// identity-(re)map [paddr, paddr+len) as write-combining (display memory);
+// -1 unless the range sits in the VGA hole or the kernel-high area, unwrapped
+int  paging_map_wc(uint32_t paddr, uint32_t len);
+
 page_directory_t paging_kernel_directory(void);
 void paging_switch_directory(page_directory_t dir);
 
 int paging_map_in(page_directory_t dir, uint32_t vaddr, uint32_t paddr, uint32_t flags);
 int paging_alloc_map_in(page_directory_t dir, uint32_t vaddr, uint32_t flags);
+// Clear one PTE in 'dir'; returns the old entry (0 if nothing was mapped).
+// The frame isn't freed, that's the caller's call (see P_SHARED).
+uint32_t paging_unmap_in(page_directory_t dir, uint32_t vaddr);
 uint32_t paging_translate_in(page_directory_t dir, uint32_t vaddr);
 
 page_directory_t paging_clone_directory(page_directory_t src);
+// Give back what a clone owns: user frames (not P_SHARED ones), its private
+// page tables and the directory itself. 'dir' must not be the loaded one.
+void paging_free_directory(page_directory_t dir);
+
+// Map one physical frame at a kernel VA. Must be called with IRQs off and
+// undone in LIFO order (the slots form a small stack).
+void* paging_kmap(uint32_t paddr);
+void  paging_kunmap(void* vaddr);
+
+// Write into another directory's memory without switching CR3. Destination
+// pages must already be mapped in 'dir'. Return 0, or -1 on an unmapped page.
+int paging_copy_to_dir(page_directory_t dir, uint32_t vaddr, const void* src, uint32_t len);
+int paging_memset_in_dir(page_directory_t dir, uint32_t vaddr, uint8_t val, uint32_t len);
 
-uint32_t* paging_current_pd_virt(void);
\ No newline at end of file
+uint32_t* paging_current_pd_virt(void);
+// AP bring-up: this CPU runs on the kernel directory the trampoline loaded
+void paging_init_cpu(void);
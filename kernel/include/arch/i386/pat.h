@@ -0,0 +1,8 @@
+#pragma once
+#include <stdint.h>
+
+// Reprograms PAT entry 1 (PWT=1) as write-combining. Safe to call once at boot.
+void pat_init(void);
+// AP bring-up: same table on this CPU, quietly
+void pat_init_cpu(void);
+int  pat_wc_supported(void);
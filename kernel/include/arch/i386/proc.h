@@ -0,0 +1,68 @@
+#pragma once
+#include <stdint.h>
+#include <arch/i386/paging.h>
+#include <arch/i386/isr.h>
+#include <arch/i386/thread.h>
+#include <arch/i386/uvm.h>
+#include <arch/i386/ufd.h>
+
+#define PROC_MAX      16
+#define PROC_NAME_LEN 32
+
+typedef enum {
+    PROC_UNUSED = 0,
+    PROC_LOADING,       // slot taken, image not mapped yet
+    PROC_RUNNING,       // has a thread; READY/RUNNING is the thread's business
+} proc_state_t;
+
+// One user program. It runs on its own kernel thread: the thread stack is
+// the process's kernel stack (tss.esp0 / SYSENTER land at its top), so the
+// user registers of the last kernel entry sit in the regs_t right below it.
+typedef struct proc {
+    uint32_t pid;
+    proc_state_t state;
+    char name[PROC_NAME_LEN];
+
+    page_directory_t dir;
+    thread_t* thread;
+    uint32_t kstack_top;
+
+    uint32_t entry;
+    uint32_t user_stack_top;
+
+    uvm_t uvm;          // heap + mmap regions
+    ufd_table_t fds;
+    uint32_t uring_frame;       // ring page mapped at URING_VA, 0 until uring_setup
+    uint32_t uring_flags;       // URING_F_*, kernel copy
+    volatile int uring_kick;    // a tick asked for a poll pass
+    const struct elf_cache_entry* image;    // exec cache entry mapped, if any
+
+    // accounting; CPU time is on the thread
+    uint32_t image_frames;  // ELF pages + stack, mapped at exec
+    uint32_t syscalls;
+    uint32_t faults;        // page faults taken, demand paging included
+} proc_t;
+
+// Take a free slot (zeroed, fresh pid). 0 if the table is full.
+proc_t* proc_alloc(const char* name);
+// Drop a process that never started: address space, files, slot.
+void proc_free(proc_t* p);
+// Give a loaded process its thread; it enters ring 3 at 'entry' when first scheduled.
+int proc_start(proc_t* p, uint32_t entry, uint32_t user_stack_top);
+
+// Process of the running thread, 0 on kernel threads.
+proc_t* proc_current(void);
+// Slot i of the table (0..PROC_MAX-1), or 0 if unused
+const proc_t* proc_get(int i);
+
+// Frames mapped for it: image, stack, and heap/mmap pages faulted in so far
+uint32_t proc_resident_frames(const proc_t* p);
+
+// User registers saved at the last kernel entry.
+regs_t* proc_user_regs(const proc_t* p);
+
+// Tear the current process down and never return. IRQs get disabled.
+__attribute__((noreturn)) void proc_exit(int32_t code);
+
+// schedule(): load the next thread's address space and kernel stack.
+void proc_switch_in(const thread_t* t);
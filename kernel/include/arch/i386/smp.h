@@ -0,0 +1,34 @@
+// smp.h
+#pragma once
+#include <stdint.h>
+#include <arch/i386/gdt.h>
+
+#define CPU_MAX 8
+
+// Every CPU loads its own TSS selector (GDT_TSS_SEL), so the task register
+// says which one we are. Reads 0 before ltr, which is the BSP during boot.
+static inline uint32_t cpu_id(void) {
+    uint16_t sel;
+    __asm__ volatile ("str %0" : "=r"(sel));
+    return sel >= GDT_TSS_SEL(0) ? (uint32_t)(sel - GDT_TSS_SEL(0)) / 8u : 0;
+}
+
+// BSP, PIT running, after paging: start every AP the local APIC can reach.
+// Stays on one CPU if there's no APIC.
+void smp_init(void);
+uint32_t smp_cpu_count(void);       // CPUs online, BSP included
+int smp_cpu_online(uint32_t cpu);
+uint32_t smp_apic_id(uint32_t cpu);
+// Kick 'cpu' out of hlt/user mode so it runs sched_preempt
+void smp_send_resched(uint32_t cpu);
+
+// Big kernel lock: until the subsystems get locks of their own, kernel code
+// (trap, syscall and PIC IRQ handlers, kernel threads) runs under this one.
+// Recursive per CPU; schedule() drops it across a switch and the resumed
+// thread takes back its own depth. Never take it while holding an rq lock.
+void bkl_lock(void);
+void bkl_unlock(void);
+uint32_t bkl_release_all(void);     // returns the depth we held, 0 if none
+void bkl_reacquire(uint32_t depth);
+// This CPU holds it (IRQs off, or the answer can go stale)
+int bkl_held(void);
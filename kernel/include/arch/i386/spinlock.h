@@ -0,0 +1,64 @@
+// spinlock.h
+#pragma once
+#include <stdint.h>
+#include <arch/i386/cpu.h>
+
+// Ticket lock: take a number from 'next', wait until 'owner' calls it. FIFO,
+// so a CPU that keeps re-taking a lock can't starve the others the way a
+// plain xchg lock lets it. Waiters spin on a read, not a locked op.
+//
+// Stats are updated by the holder, so they need no atomics of their own:
+// acquisitions, how many of those had to wait, total spin iterations and the
+// longest hold in TSC cycles. Locks set up with spin_init are listed by
+// the `locks` shell command.
+typedef struct spinlock {
+    volatile uint32_t next;
+    volatile uint32_t owner;
+    const char* name;
+    uint32_t acquires;
+    uint32_t contended;
+    uint64_t spins;
+    uint64_t hold_start;
+    uint64_t hold_max;
+    struct spinlock* list_next;     // spin_init registry
+} spinlock_t;
+
+#define SPINLOCK_INIT { .next = 0, .owner = 0 }
+
+// Name it and add it to the registry. Call once; leaves the lock state
+// alone, so a lock that is already in use can be registered too.
+void spin_init(spinlock_t* l, const char* name);
+// Registered locks, most recent first
+spinlock_t* spin_lock_list(void);
+void spin_stats_reset(void);
+
+extern int g_spin_tsc;
+void spin_wait(spinlock_t* l, uint32_t ticket);
+
+// Doesn't touch IF: use the irqsave variants for anything an IRQ handler
+// on the same CPU may also take.
+static inline void spin_lock(spinlock_t* l) {
+    uint32_t ticket = __atomic_fetch_add(&l->next, 1u, __ATOMIC_RELAXED);
+    if (__atomic_load_n(&l->owner, __ATOMIC_ACQUIRE) != ticket) spin_wait(l, ticket);
+    l->acquires++;
+    if (g_spin_tsc) l->hold_start = rdtsc();
+}
+
+static inline void spin_unlock(spinlock_t* l) {
+    if (g_spin_tsc) {
+        uint64_t held = rdtsc() - l->hold_start;
+        if (held > l->hold_max) l->hold_max = held;
+    }
+    __atomic_store_n(&l->owner, l->owner + 1u, __ATOMIC_RELEASE);
+}
+
+static inline uint32_t spin_lock_irqsave(spinlock_t* l) {
+    uint32_t f = irq_save();
+    spin_lock(l);
+    return f;
+}
+
+static inline void spin_unlock_irqrestore(spinlock_t* l, uint32_t f) {
+    spin_unlock(l);
+    irq_restore(f);
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <stdint.h>
+#include <arch/i386/isr.h>
+#include <sys/syscall_list.h>
+
+// latency buckets: [0] < 128 cycles, [i] < 128 << i, last one open-ended
+#define SYSCALL_HIST_BUCKETS 12
+
+typedef struct {
+    uint32_t calls;
+    uint64_t cycles;                      // total, TSC
+    uint32_t hist[SYSCALL_HIST_BUCKETS];
+} syscall_stat_t;
+
+// Every sys_<name> in the list, wherever it's implemented
+#define SYSCALL_DECL(n, name) uint32_t sys_##name(regs_t* r);
+SYSCALL_LIST(SYSCALL_DECL)
+#undef SYSCALL_DECL
+
+// write(fd, buf, len) body, shared with the rings
+int32_t ksys_write(uint32_t fd, const char* ubuf, uint32_t len);
+
+// Both entry paths (int 0x80, SYSENTER) land here: eax = number,
+// ebx/ecx/edx = args, result back in eax.
+void syscall_handle(regs_t* r);
+
+const syscall_stat_t* syscall_stat(uint32_t num);
+const char* syscall_name(uint32_t num);
+void syscall_stats_reset(void);
@@ -0,0 +1,13 @@
+#pragma once
+#include <arch/i386/isr.h>
+
+// Program the SYSENTER MSRs if the CPU has SEP. int 0x80 keeps working
+// either way; returns 1 when the fast path is enabled, and then tells user
+// space through VTIME_F_SYSENTER in the time page.
+int  sysenter_init(void);
+int  sysenter_supported(void);
+// AP bring-up: same MSRs on this CPU (after its TSS is loaded)
+void sysenter_init_cpu(void);
+
+// C side of the fast path, called by sysenter_entry with a regs_t frame
+void sysenter_handler(regs_t* r);
@@ -0,0 +1,137 @@
+#pragma once
+#include <stdint.h>
+#include <arch/i386/fpu.h>
+
+#define THREAD_MAX          32
+#define THREAD_STACK_SIZE   8192u
+#define THREAD_NAME_LEN     16
+
+// Level-0 time slice, in PIT ticks (50ms at 100Hz). Level n gets (n+1) of them.
+#define SCHED_QUANTUM_DEFAULT 5u
+
+// Multi-level feedback queue: level 0 runs first. A thread that burns its
+// whole slice drops a level, one that blocks comes back up one, and every
+// SCHED_BOOST_TICKS everything returns to level 0 so nothing starves.
+#define SCHED_LEVELS      8
+#define SCHED_BOOST_TICKS 100u
+
+// Each CPU has its own set of levels. Every SCHED_BALANCE_TICKS a CPU looks
+// for the busiest one and pulls a READY thread over if it is 2+ ahead.
+#define SCHED_BALANCE_TICKS 10u
+
+typedef enum {
+    THREAD_UNUSED = 0,
+    THREAD_READY,
+    THREAD_RUNNING,
+    THREAD_BLOCKED,             // off every queue until thread_wake
+    THREAD_DEAD,
+} thread_state_t;
+
+typedef void (*thread_fn)(void* arg);
+
+struct proc;
+
+typedef struct thread {
+    uint32_t esp;               // saved by context_switch; keep first
+    uint32_t id;
+    thread_state_t state;
+    char name[THREAD_NAME_LEN];
+    thread_fn fn;
+    void* arg;
+    uint8_t* stack;             // base of the stack; 0 for the boot thread
+    uint32_t switches;          // times switched in
+    uint64_t ticks;             // timer ticks seen while running
+    uint32_t level;             // MLFQ level, 0 = highest
+    uint64_t enq_tsc;           // when it last became READY (queue latency)
+    struct proc* proc;          // user process this thread runs, 0 for kernel threads
+    struct thread* next;        // run queue link
+    uint32_t cpu;               // CPU whose queue it is on / last ran on
+    volatile int on_cpu;        // still on a CPU's stack, until the switch away completes
+    uint32_t bkl_depth;         // big kernel lock depth to take back on resume
+    uint32_t migrations;        // times the balancer moved it
+    int pinned;                 // never migrated: boot contexts, per-CPU workers
+    int wake_pending;           // woken while not blocked; next thread_block returns at once
+    uint64_t utime;             // TSC cycles run in ring 3
+    uint64_t stime;             // ... in the kernel (for idle threads: idle time)
+    uint64_t acct_tsc;          // start of the stretch not charged yet
+    int in_user;                // and which of the two it goes to
+    int fpu_used;               // fpu_state holds something (see fpu.h)
+    uint32_t fpu_cpu;           // CPU it last loaded its FPU state on
+    uint8_t fpu_state[FPU_STATE_SIZE] __attribute__((aligned(16)));   // FXSAVE area
+} thread_t;
+
+typedef struct {
+    uint32_t dispatches;        // times a thread was picked from this level
+    uint32_t demotions;         // threads that fell into this level
+    uint32_t ticks;             // timer ticks run at this level
+    uint64_t wait_cycles;       // READY -> running, summed (TSC)
+    uint64_t wait_max;
+} sched_level_stat_t;
+
+typedef struct {
+    int online;
+    uint32_t current;           // id of the running thread
+    uint32_t nr_ready;          // queued on this CPU
+    uint32_t migrations;        // threads pulled in by the balancer
+    uint64_t ticks;
+    uint64_t idle_ticks;
+} sched_cpu_stat_t;
+
+// Turn the running boot context into thread 0 ("main") on CPU 0.
+void sched_init(void);
+// AP bring-up: the running boot context becomes this CPU's thread; it
+// goes on to call sched_idle().
+void sched_init_cpu(void);
+
+// New kernel thread, READY at the tail of level 0 on the least loaded CPU.
+// 0 if the table is full.
+thread_t* thread_create(const char* name, thread_fn fn, void* arg);
+// Same, bound to a process: its directory and kernel stack are loaded on every switch in.
+thread_t* thread_spawn(const char* name, thread_fn fn, void* arg, struct proc* proc);
+// Kernel thread that always runs on 'cpu' (which must be online)
+thread_t* thread_create_on(const char* name, thread_fn fn, void* arg, uint32_t cpu);
+void thread_yield(void);
+// Stop running until someone calls thread_wake. IRQs must be off. A wake
+// that lands between the caller's check and the block (from another CPU)
+// isn't lost: it makes this return at once, so callers re-check in a loop.
+void thread_block(void);
+// BLOCKED -> READY, one level up, on the CPU it last ran on. Preempts that
+// CPU's running thread at the next IRQ exit (IPI if remote) if the woken one
+// now outranks it. A thread that isn't blocked yet gets wake_pending instead.
+void thread_wake(thread_t* t);
+__attribute__((noreturn)) void thread_exit(void);
+// 0 while this CPU has no idle thread yet (boot): thread_block could find
+// nothing to run, so waits halt until the next interrupt instead
+int sched_can_block(void);
+thread_t* thread_current(void);
+// Slot i of the thread table (0..THREAD_MAX-1), or 0 if unused
+const thread_t* thread_get(int i);
+
+// The caller becomes this CPU's idle thread: it runs only when every level
+// is empty and halts until the next interrupt.
+__attribute__((noreturn)) void sched_idle(void);
+
+// This CPU's tick (PIT on the BSP, local APIC timer on APs): charge the
+// running thread, flag a switch when its slice is used up, boost every level
+// back to 0 every SCHED_BOOST_TICKS, balance every SCHED_BALANCE_TICKS
+void sched_tick(void);
+// IRQ exit, after EOI and with the handler's own BKL hold dropped: switch if
+// the tick asked for it, unless the interrupted code holds the BKL
+void sched_preempt(void);
+
+// CPU time accounting (TSC): the running thread's time is charged at every
+// switch and tick, and at each ring 3 <-> kernel crossing, which the entry
+// paths (IRQs, exceptions, int 0x80, SYSENTER) report with these. IRQs off.
+void sched_acct_kernel_entry(void);
+void sched_acct_user_return(void);
+
+void     sched_set_quantum(uint32_t ticks);
+uint32_t sched_quantum(void);
+
+// Per-level counters summed over CPUs into *out; queued threads in *queued if non-null.
+int sched_level_stat(uint32_t level, sched_level_stat_t* out, uint32_t* queued);
+int sched_cpu_stat(uint32_t cpu, sched_cpu_stat_t* out);
+void sched_stats_reset(void);
+
+// switch.S: save callee-saved regs + EFLAGS on this stack, store esp in *save, resume next_esp
+void context_switch(uint32_t* save, uint32_t next_esp);
@@ -0,0 +1,64 @@
+#pragma once
+#include <stdint.h>
+#include <arch/i386/paging.h>
+#include <arch/i386/workqueue.h>
+
+void     timer_init(uint32_t hz);
+uint64_t timer_ticks(void);
+uint32_t timer_hz(void);
+// TSC cycles per tick, measured over the first ticks after boot; 0 until then or without a TSC
+uint64_t timer_tsc_per_tick(void);
+
+// Map the read-only time page (see <sys/vtime.h>) into a user directory.
+int vtime_map(page_directory_t dir);
+// Publish VTIME_F_* bits to user space (boot, before the first process)
+void vtime_set_features(uint32_t f);
+
+// Kernel timers on a hashed hierarchical wheel: TIMER_LEVELS levels of
+// TIMER_SLOTS slots, level n covering TIMER_SLOTS^(n+1) ticks ahead. A timer
+// is hashed into one slot by its expiry, so add and cancel are O(1) list
+// operations. Each tick looks at one level-0 slot; every TIMER_SLOTS ticks
+// the next level's due slot is spread back down (cascaded). Timers further
+// out than the wheel reaches sit in the last level and go round again.
+#define TIMER_SLOT_BITS 6
+#define TIMER_SLOTS     (1u << TIMER_SLOT_BITS)
+#define TIMER_LEVELS    4
+
+#define KTIMER_DEFERRED 0x1u    // fn runs in kworker (IRQs on), not in IRQ0
+
+typedef void (*ktimer_fn)(void* arg);
+
+typedef struct ktimer {
+    struct ktimer* next;        // slot list
+    struct ktimer* prev;
+    uint64_t expires;           // tick it's due at
+    ktimer_fn fn;
+    void* arg;
+    uint32_t flags;             // KTIMER_*
+    int pending;                // on the wheel
+    uint8_t level, slot;        // where it hangs while pending
+    work_t work;                // KTIMER_DEFERRED
+} ktimer_t;
+
+typedef struct {
+    uint32_t added;
+    uint32_t cancelled;         // timer_cancel calls that found it pending
+    uint32_t fired;
+    uint32_t cascaded;          // moves from a level down to a lower one
+    uint32_t pending[TIMER_LEVELS];
+} timer_wheel_stat_t;
+
+void timer_setup(ktimer_t* t, ktimer_fn fn, void* arg, uint32_t flags);
+// Fire 'ticks' from now (0 = on the next tick; from a fn, the tick after the
+// one firing). A pending timer is moved.
+// Any context; fn may re-add its own timer.
+void timer_add(ktimer_t* t, uint32_t ticks);
+// 1 if it was pending and now won't fire. 0 if it already fired; then fn
+// has returned by the time this does, unless the caller is fn itself. A
+// deferred timer's work may still be queued: don't free it then.
+int  timer_cancel(ktimer_t* t);
+void timer_wheel_stat(timer_wheel_stat_t* out);
+// Once, from timer_init: names the wheel's lock (timers work before it)
+void timer_wheel_init(void);
+// IRQ0 (BSP): run the slots of every tick up to 'now'
+void timer_wheel_tick(uint64_t now);
@@ -2,4 +2,11 @@
 #include <stdint.h>
 
 void tss_init(void);
+void tss_init_cpu(uint32_t cpu);
+// ltr; sel is GDT_TSS_SEL(cpu)
+void tss_flush(uint16_t sel);
+// this CPU's esp0
 void tss_set_kernel_stack(uint32_t esp0);
+
+// &tss.esp0 of this CPU, so fast entry paths can load the current kernel stack from it
+uint32_t* tss_kernel_stack_slot(void);
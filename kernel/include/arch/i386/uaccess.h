@@ -0,0 +1,33 @@
+#pragma once
+#include <stdint.h>
+#include <arch/i386/isr.h>
+
+// User pointers must fall inside this window. The top 1GB is kept out of it
+// for kernel-only mappings (LAPIC, framebuffers, ...).
+#define USER_SPACE_START 0x00400000u
+#define USER_SPACE_END   0xC0000000u
+
+// The kernel identity map (0..KERNEL_ID_MAP_MB) overlaps the window, with the
+// user image, stack, rings and time page mapped in between its pages, so the
+// window alone proves nothing. Every page of the range must also be a user
+// page in the loaded directory: present with P_USER, or not present at all
+// (lazily backed, or bad, and then the copy faults into its fixup).
+// Writes to read-only user pages fault too, since CR0.WP is set.
+int access_ok(const void* uptr, uint32_t len);
+
+// All of these return 0 on success, -1 if the range is bad or faults.
+// A faulting copy is redirected through the exception table (__ex_table)
+// so no per-page translate is needed up front.
+int copy_from_user(void* dst, const void* usrc, uint32_t n);
+int copy_to_user(void* udst, const void* src, uint32_t n);
+// Same, for reads that report what landed: bytes copied before a fault
+// (0 if the range is bad).
+uint32_t copy_to_user_partial(void* udst, const void* src, uint32_t n);
+
+// Copies at most n bytes including the NUL.
+// Returns string length, n if no NUL was found in n bytes, -1 on fault.
+int strncpy_from_user(char* dst, const char* usrc, uint32_t n);
+
+// Called by the page fault handler: if r->eip is a user-copy instruction,
+// rewrite it to the fixup address and return 1.
+int extable_fixup(regs_t* r);
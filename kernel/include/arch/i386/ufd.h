@@ -0,0 +1,23 @@
+#pragma once
+#include <stdint.h>
+
+// Per-process file descriptors: 0..2 are the console, 3.. name VFS files.
+#define UFD_MAX 16
+
+typedef struct {
+    int vfd[UFD_MAX];   // VFS fd per user fd, -1 = closed (0..2 unused)
+} ufd_table_t;
+
+// Fresh table for a new process / close everything it left open.
+void ufd_init(ufd_table_t* t);
+void ufd_close_all(ufd_table_t* t);
+
+// Bodies of the file syscalls, shared with the rings. User pointers are
+// validated here; results are syscall-style (-1 on error).
+int32_t ufd_open(const char* upath);
+int32_t ufd_close(int32_t fd);
+int32_t ufd_read(int32_t fd, void* ubuf, uint32_t len);
+int32_t ufd_pread(int32_t fd, void* ubuf, uint32_t len, uint32_t off);
+
+// VFS fd behind a user fd, or -1 (console fds and closed slots)
+int ufd_vfs(int32_t fd);
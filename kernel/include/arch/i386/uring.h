@@ -0,0 +1,10 @@
+#pragma once
+#include <arch/i386/isr.h>
+#include <sys/uring.h>
+
+// Timer tick hook (IRQ0): only notes that the interrupted process opted
+// into URING_F_POLL. Touches no ring memory and runs no I/O.
+void uring_poll_tick(regs_t* r);
+// On the way back to user mode from an IRQ, on the process's own thread:
+// drains a bounded batch if a tick asked for it, like a uring_enter would.
+void uring_poll_user(void);
@@ -0,0 +1,56 @@
+#pragma once
+#include <stdint.h>
+#include <arch/i386/paging.h>
+
+// User address space layout above the identity map (ELF, stack, rings and
+// the time page live below it). Heap and anonymous mappings are only
+// reserved here; frames arrive on first touch.
+#define UVM_IMAGE_BASE  0x00400000u   // ELF images link here (initrd/hello.ld)
+#define UVM_IMAGE_END   0x00800000u
+#define UVM_STACK_TOP   0x02000000u   // 32MB
+#define UVM_STACK_PAGES 4u
+
+#define UVM_HEAP_BASE   0x10000000u   // brk starts here, grows up
+#define UVM_HEAP_MAX    0x40000000u
+#define UVM_MMAP_BASE   0x40000000u   // mmap() picks from here up
+#define UVM_MMAP_END    0xB0000000u
+
+#define UVM_MAX_REGIONS 32
+
+#define UVM_R_WRITE 0x1u
+
+typedef struct {
+    uint32_t start, end;   // page aligned, [start, end)
+    uint32_t flags;        // UVM_R_*
+
+    // file-backed: resident file bytes, 'start' shows byte 'file_off'
+    const uint8_t* file;
+    uint32_t file_size;
+    uint32_t file_off;
+} uvm_region_t;
+
+typedef struct {
+    page_directory_t dir;
+    uint32_t brk;                              // heap is [UVM_HEAP_BASE, align_up(brk))
+    uvm_region_t regions[UVM_MAX_REGIONS];     // sorted by start
+    uint32_t nregions;
+    uint32_t resident;                         // frames faulted in
+} uvm_t;
+
+// Empty heap and no mappings for a new process. The frames it faults in go
+// back with its directory (paging_free_directory).
+void uvm_init(uvm_t* vm, page_directory_t dir);
+
+// Page fault on a reserved but not yet backed page of the current process:
+// map a zeroed frame and return 1. 0 = not ours.
+int uvm_fault(uint32_t addr, uint32_t err);
+
+// Reserve a range, returns start VA or 0. file == NULL is anonymous memory;
+// otherwise pages come from the resident file bytes: read-only pages whose
+// bytes sit page-aligned are the file's own frames (shared by every mapper),
+// the rest are private copies. Used by sys_mmap.
+uint32_t uvm_map(uint32_t hint, uint32_t len, uint32_t flags, int fixed,
+                 const uint8_t* file, uint32_t file_size, uint32_t file_off);
+int      uvm_unmap(uint32_t addr, uint32_t len);
+
+const uvm_t* uvm_current(void);
@@ -0,0 +1,76 @@
+// wait.h
+#pragma once
+#include <stdint.h>
+#include <arch/i386/cpu.h>
+#include <arch/i386/spinlock.h>
+#include <arch/i386/timer.h>
+
+// Wait queues: a thread that needs an event parks itself on a queue and
+// gives up the CPU; whoever produces the event (an IRQ handler, another
+// thread, another CPU) calls wake_up. Waits can also time out, counted in
+// timer ticks. Nothing spins while it waits.
+//
+// The entries live on the waiters' stacks. An entry is off every list by
+// the time its wait returns.
+
+struct thread;
+struct wait_queue;
+
+typedef struct wait_entry {
+    struct thread* thread;
+    struct wait_queue* queue;   // 0 for a plain timed sleep
+    struct wait_entry* next;    // queue link
+    ktimer_t timeout;           // armed only for timed waits
+    int on_queue;
+    int timed;
+    volatile int woken;         // taken off the queue by wake_up
+    volatile int timed_out;
+} wait_entry_t;
+
+typedef struct wait_queue {
+    spinlock_t lock;
+    wait_entry_t* head;
+    wait_entry_t* tail;
+} wait_queue_t;
+
+#define WAIT_QUEUE_INIT { .lock = SPINLOCK_INIT }
+
+// Only names the lock for `locks`; a zeroed or WAIT_QUEUE_INIT queue works as is
+void wait_queue_init(wait_queue_t* q, const char* name);
+
+// Sleep until the next wake_up on q. The caller checks its condition with
+// IRQs off right before, so this only suits events raised from IRQs on this
+// CPU; anything else should use wait_event, which re-checks while queued.
+void sleep_on(wait_queue_t* q);
+// Same with a limit: 1 if woken, 0 if 'ticks' went by first
+int sleep_on_timeout(wait_queue_t* q, uint32_t ticks);
+// Give the CPU up for at least 'ticks' timer ticks (0 = just yield)
+void thread_sleep(uint32_t ticks);
+
+// Wake the oldest waiter / every waiter. Any context. Returns how many woke.
+int wake_up(wait_queue_t* q);
+int wake_up_all(wait_queue_t* q);
+
+// The pieces wait_event is made of; IRQs off from prepare to finish.
+// wait_block returns 0 once the wait has timed out, else 1 (after a wakeup
+// or a spurious return) meaning "check the condition again". wait_finish
+// passes an unused wakeup on to the next waiter unless 'consumed'.
+void wait_prepare(wait_queue_t* q, wait_entry_t* e, uint32_t ticks);
+int  wait_block(wait_entry_t* e);
+void wait_finish(wait_entry_t* e, int consumed);
+
+// Block until 'cond' holds; whoever makes it true calls wake_up(q) after.
+// cond is evaluated with IRQs off and may be evaluated several times.
+#define wait_event(q, cond) ((void)wait_event_timeout((q), (cond), 0))
+
+// Same, giving up after 'ticks' (0 = never). Nonzero if cond held.
+#define wait_event_timeout(q, cond, ticks) ({                       \
+    wait_entry_t _we;                                               \
+    int _ok;                                                        \
+    uint32_t _wf = irq_save();                                      \
+    wait_prepare((q), &_we, (ticks));                               \
+    while (!(_ok = !!(cond)) && wait_block(&_we)) {}                \
+    wait_finish(&_we, _ok);                                         \
+    irq_restore(_wf);                                               \
+    _ok;                                                            \
+})
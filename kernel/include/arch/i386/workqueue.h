@@ -0,0 +1,40 @@
+// workqueue.h
+#pragma once
+#include <stdint.h>
+
+// Deferred work: IRQ handlers (any CPU, IRQs off) hand a work item to the
+// kworker thread and return; kworker runs it later with IRQs on, as an
+// ordinary preemptible kernel thread under the BKL.
+//
+// Items are intrusive and owned by the caller. Queueing one that is already
+// pending is a no-op, so an IRQ that fires faster than the work drains just
+// folds into the pending run; the handler must look at all the state it
+// finds (a ring, a counter), not one event per call.
+
+typedef void (*work_fn)(void* arg);
+
+typedef struct work {
+    struct work* next;
+    work_fn fn;
+    void* arg;
+    volatile uint32_t pending;  // queued and not yet started
+    uint64_t queued_tsc;
+} work_t;
+
+#define WORK_INIT(f, a) { .fn = (f), .arg = (a) }
+
+typedef struct {
+    uint32_t queued;            // work_queue calls that queued an item
+    uint32_t merged;            // ... that found it already pending
+    uint32_t run;
+    uint64_t wait_cycles;       // queued -> started, summed (TSC)
+    uint64_t wait_max;
+} workqueue_stat_t;
+
+// Start kworker, pinned to the BSP where the PIC delivers IRQs: an IRQ that
+// comes in while it holds the BKL nests instead of spinning on it.
+void workqueue_init(void);
+// Lock-free, any context. 1 if queued, 0 if it was already pending.
+int work_queue(work_t* w);
+const workqueue_stat_t* workqueue_stat(void);
+void workqueue_stats_reset(void);
@@ -4,6 +4,11 @@
 #define EI_NIDENT 16
 #define PT_LOAD   1
 
+// p_flags
+#define PF_X 0x1
+#define PF_W 0x2
+#define PF_R 0x4
+
 typedef struct {
     unsigned char e_ident[EI_NIDENT];
     uint16_t e_type;
@@ -0,0 +1,40 @@
+#pragma once
+#include <stdint.h>
+#include <kernel/elf.h>
+
+// Bounded: at most ELF_CACHE_SLOTS binaries, each with up to
+// ELF_CACHE_MAX_PAGES prepared read-only pages (pages past that are loaded
+// privately). When every slot is taken the least recently used entry no
+// process is running gets evicted; if all are running, nothing is cached.
+#define ELF_CACHE_SLOTS     16
+#define ELF_CACHE_MAX_PH    8
+#define ELF_CACHE_MAX_PAGES 256
+
+// One exec'd initrd binary: parsed headers plus one set of prepared frames
+// for its read-only pages, mapped P_SHARED into every process that runs it.
+typedef struct elf_cache_entry {
+    char        path[128];
+    const void* data;        // resident image; with path, the cache key
+    uint32_t    entry;
+    uint16_t    phnum;
+    Elf32_Phdr  ph[ELF_CACHE_MAX_PH];
+    uint16_t    first[ELF_CACHE_MAX_PH];  // segment's first slot in frames, if cached
+    uint16_t    count[ELF_CACHE_MAX_PH];  // pages cached for it (0 = load privately)
+    uint32_t    frames[ELF_CACHE_MAX_PAGES]; // 0 = load privately; bit 0 = ours to free
+    uint32_t    users;       // processes mapping the frames
+    uint32_t    last_use;    // LRU stamp
+    uint32_t    hits;
+} elf_cache_entry_t;
+
+// Both return the entry with a reference taken; elf_cache_put drops it once
+// the frames are no longer mapped anywhere.
+const elf_cache_entry_t* elf_cache_lookup(const char* path, const void* data);
+
+// Headers must already be validated against the image. Returns NULL when the
+// cache is full of running binaries or there are too many program headers.
+const elf_cache_entry_t* elf_cache_insert(const char* path, const void* data,
+                                          const Elf32_Ehdr* eh, const Elf32_Phdr* ph);
+void elf_cache_put(const elf_cache_entry_t* e);
+
+// Prepared read-only frame for page 'va' of segment 'seg', or 0.
+uint32_t elf_cache_frame(const elf_cache_entry_t* e, uint16_t seg, uint32_t va);
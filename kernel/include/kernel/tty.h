@@ -2,12 +2,19 @@
 #define _KERNEL_TTY_H
 
 #include <stddef.h>
+#include <stdint.h>
+
+// text mode screen size; the VGA buffer and tty.c's shadow of it
+#define TERMINAL_WIDTH  80
+#define TERMINAL_HEIGHT 25
 
 void terminal_initialize(void);
 void terminal_putchar(char c);
 void terminal_write(const char* data, size_t size);
 void terminal_writestring(const char* data);
 void terminal_clear_eol(void);
-static void terminal_scroll(void);
+void terminal_setcolor(uint8_t color);
+// one cell, raw VGA attribute; the cursor doesn't move
+void terminal_putentryat(unsigned char c, uint8_t color, size_t x, size_t y);
 
 #endif
\ No newline at end of file
@@ -1,4 +1,4 @@
 #pragma once
 #include <stdint.h>
 
-int user_exec(const char* path);  // loads + enters ring3, never returns on success
+int user_exec(const char* path);  // loads a new process and queues it; pid, or -1
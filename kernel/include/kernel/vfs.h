@@ -13,6 +13,10 @@ typedef struct {
 
     // lookup child "name" under a directory vnode -> returns vnode* or NULL
     vnode_t* (*lookup)(vnode_t* dir, const char* name);
+
+    // optional: file contents already resident in (identity-mapped) memory,
+    // or NULL. Lets loaders use the bytes in place instead of copying.
+    const void* (*data)(vnode_t* vn);
 } vnode_ops_t;
 
 struct vnode {
@@ -26,6 +30,7 @@ typedef struct {
     vnode_t* vn;
     uint32_t off;
     uint8_t  used;
+    uint8_t  busy;           // a read or seek owns 'off' (vfs_file_claim)
 } file_t;
 
 typedef struct {
@@ -37,8 +42,26 @@ typedef struct {
 void vfs_init(vnode_t* root);
 int  vfs_open(const char* path);
 int  vfs_read(int fd, void* buf, uint32_t len);
+int  vfs_pread(int fd, uint32_t off, void* buf, uint32_t len); // doesn't move the file offset
 int  vfs_close(int fd);
 
+#define VFS_SEEK_SET 0
+#define VFS_SEEK_CUR 1
+#define VFS_SEEK_END 2
+
+// new offset, or -1 (negative result or bad whence); may point past EOF
+int32_t vfs_lseek(int fd, int32_t off, int whence);
+
+// Own the file offset across a read done elsewhere (ufd's user copies):
+// claim sleeps while another read or seek has it and returns the offset,
+// or -1 if fd isn't open; release moves it by 'advance' and lets the next in.
+int32_t vfs_file_claim(int fd);
+void    vfs_file_release(int fd, uint32_t advance);
+int  vfs_fstat(int fd, vfs_stat_t* st);
+
+// resident contents of an open file (see vnode_ops_t.data), NULL if none
+const void* vfs_data(int fd, uint32_t* size_out);
+
 // directory helpers
 int  vfs_ls(const char* path);
 int  vfs_stat(const char* path, vfs_stat_t* st);
\ No newline at end of file
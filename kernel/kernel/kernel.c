@@ -18,6 +18,12 @@
 #include <arch/i386/gdt.h>
 #include <arch/i386/tss.h>
 #include <arch/i386/idt.h>
+#include <arch/i386/pat.h>
+#include <arch/i386/fpu.h>
+#include <arch/i386/sysenter.h>
+#include <arch/i386/thread.h>
+#include <arch/i386/smp.h>
+#include <arch/i386/workqueue.h>
 
 void interrupts_init(void);
 // void ssp_test_run(void);
@@ -66,6 +72,11 @@ void kernel_main(uint32_t multiboot_magic, void* multiboot_info_ptr) {
     multiboot1_init(multiboot_magic, multiboot_info_ptr);
     boot_cmdline = multiboot1_cmdline();
 
+	// THREADS: the boot context becomes thread 0 before the PIT starts ticking
+	sched_init();
+	// kworker: IRQ handlers defer everything slow (the shell included) to it
+	workqueue_init();
+
 	// INTERRUPTS
 	interrupts_init();
 
@@ -79,12 +90,31 @@ void kernel_main(uint32_t multiboot_magic, void* multiboot_info_ptr) {
 
 	// PAGING
 	paging_init_identity();
+
+	// PAT: write-combine display memory
+	pat_init();
+	paging_map_wc(0xB8000u, 0x8000u); // VGA text buffer
+	multiboot_info_t* fbi = multiboot1_info();
+	if (fbi && (fbi->flags & MULTIBOOT1_INFO_FRAMEBUFFER) &&
+	    fbi->framebuffer_type == MULTIBOOT1_FB_TYPE_RGB) {
+		// the bootloader's numbers: 64-bit address, 32x32-bit size
+		uint64_t fb_len = (uint64_t)fbi->framebuffer_pitch * fbi->framebuffer_height;
+		if (!fb_len || fbi->framebuffer_addr > 0xFFFFFFFFull ||
+		    fb_len > 0x100000000ull - fbi->framebuffer_addr ||
+		    paging_map_wc((uint32_t)fbi->framebuffer_addr, (uint32_t)fb_len) < 0) {
+			printf("fb: %x+%x not mapped (overlaps the kernel or past 4GB)\n",
+			       (uint32_t)fbi->framebuffer_addr, (uint32_t)fb_len);
+		}
+	}
 	// Test page fault -> core dump
 	/*
 	volatile uint32_t* bad = (uint32_t*)0xDEADBEEF;
 	(void)*bad;
 	*/
 
+	// FPU/SSE on, switched lazily through #NM
+	fpu_init();
+
 	heap_init(0x00800000u, 0x00400000u);
 
 	if (a) pmm_free_frame(a);
@@ -95,9 +125,10 @@ void kernel_main(uint32_t multiboot_magic, void* multiboot_info_ptr) {
 	tss_init(); 
 	tss_set_kernel_stack((uint32_t)(kstack + sizeof(kstack)));
 	printf("[BOOT] before tss_flush\n");
-    tss_flush();
+    tss_flush(GDT_TSS_SEL(0));
     printf("[BOOT] after tss_flush\n");
 	idt_init();
+	sysenter_init();
 
 	// DEBUG HEXDUMP OF PMM
 	multiboot_info_t* mbi = multiboot1_info();
@@ -113,6 +144,9 @@ void kernel_main(uint32_t multiboot_magic, void* multiboot_info_ptr) {
 		printf("no initrd module\n");
 	}
 
+	// SMP: wake the other CPUs, each comes up into its own idle thread
+	smp_init();
+
 	// Test userspace with ring check
 	// test_ring3_int80();
 
@@ -127,7 +161,7 @@ void kernel_main(uint32_t multiboot_magic, void* multiboot_info_ptr) {
 
 	keyboard_enable_shell(enable_shell);
 
-    for(;;) __asm__ volatile("hlt");
+    sched_idle();
 
 	/* TEST FOR ERROR */
 	//volatile int x = 1 / 0;
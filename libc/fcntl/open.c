@@ -0,0 +1,6 @@
+#include <fcntl.h>
+#include <sys/syscall.h>
+
+int open(const char* path, int flags) {
+	return (int)syscall3(SYS_open, (uint32_t)path, (uint32_t)flags, 0);
+}
@@ -0,0 +1,23 @@
+#ifndef _FCNTL_H
+#define _FCNTL_H 1
+
+#include <sys/cdefs.h>
+
+// read-only filesystem for now: only O_RDONLY opens succeed
+#define O_RDONLY 0x0
+#define O_WRONLY 0x1
+#define O_RDWR   0x2
+
+#if !defined(__is_kernel) && !defined(__is_libk)
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int open(const char* path, int flags);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
+
+#endif
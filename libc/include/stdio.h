@@ -10,6 +10,19 @@
 extern "C" {
 #endif
 
+#if !defined(__is_libk) && !defined(__is_kernel)
+#define BUFSIZ 512
+
+typedef struct __FILE {
+	char   buf[BUFSIZ];
+	size_t len;
+} FILE;
+
+extern FILE* stdout;
+
+int fflush(FILE*);
+#endif
+
 int printf(const char* __restrict, ...);
 int putchar(int);
 int puts(const char*);
@@ -10,6 +10,21 @@ extern "C" {
 __attribute__((__noreturn__))
 void abort(void);
 
+#if !defined(__is_libk) && !defined(__is_kernel)
+#include <stddef.h>
+
+#define EXIT_SUCCESS 0
+#define EXIT_FAILURE 1
+
+__attribute__((__noreturn__))
+void exit(int status);
+
+void* malloc(size_t size);
+void* calloc(size_t n, size_t size);
+void* realloc(void* ptr, size_t size);
+void  free(void* ptr);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,44 @@
+#ifndef _SYS_MMAN_H
+#define _SYS_MMAN_H 1
+
+#include <sys/cdefs.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define PROT_NONE     0x0
+#define PROT_READ     0x1
+#define PROT_WRITE    0x2
+#define PROT_EXEC     0x4
+
+#define MAP_SHARED    0x01
+#define MAP_PRIVATE   0x02
+#define MAP_FIXED     0x10
+#define MAP_ANONYMOUS 0x20
+#define MAP_ANON      MAP_ANONYMOUS
+
+#define MAP_FAILED    ((void*)-1)
+
+// SYS_mmap takes a pointer to this (six args don't fit the registers)
+struct mmap_args {
+    uint32_t addr;
+    uint32_t len;
+    uint32_t prot;
+    uint32_t flags;
+    int32_t  fd;
+    uint32_t off;
+};
+
+#if !defined(__is_kernel) && !defined(__is_libk)
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void* mmap(void* addr, size_t len, int prot, int flags, int fd, uint32_t off);
+int   munmap(void* addr, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
+
+#endif
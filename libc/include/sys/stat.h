@@ -0,0 +1,33 @@
+#ifndef _SYS_STAT_H
+#define _SYS_STAT_H 1
+
+#include <sys/cdefs.h>
+#include <stdint.h>
+
+#define S_IFMT  0xF000u
+#define S_IFDIR 0x4000u
+#define S_IFCHR 0x2000u
+#define S_IFREG 0x8000u
+
+#define S_ISDIR(m) (((m) & S_IFMT) == S_IFDIR)
+#define S_ISCHR(m) (((m) & S_IFMT) == S_IFCHR)
+#define S_ISREG(m) (((m) & S_IFMT) == S_IFREG)
+
+struct stat {
+    uint32_t st_mode;
+    uint32_t st_size;
+};
+
+#if !defined(__is_kernel) && !defined(__is_libk)
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int fstat(int fd, struct stat* st);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
+
+#endif
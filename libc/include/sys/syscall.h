@@ -0,0 +1,77 @@
+#ifndef _SYS_SYSCALL_H
+#define _SYS_SYSCALL_H 1
+
+#include <stdint.h>
+#include <sys/syscall_list.h>
+#include <sys/vtime.h>
+
+// eax = number, ebx/ecx/edx = args, result in eax
+enum {
+#define SYSCALL_NUM(n, name) SYS_##name = n,
+    SYSCALL_LIST(SYSCALL_NUM)
+#undef SYSCALL_NUM
+};
+
+// Compatible path: full interrupt gate.
+static inline uint32_t syscall3_int80(uint32_t n, uint32_t a, uint32_t b, uint32_t c) {
+    uint32_t ret;
+    __asm__ volatile ("int $0x80"
+                      : "=a"(ret)
+                      : "a"(n), "b"(a), "c"(b), "d"(c)
+                      : "memory");
+    return ret;
+}
+
+static inline uint32_t syscall5_int80(uint32_t n, uint32_t a, uint32_t b, uint32_t c,
+                                      uint32_t d, uint32_t e) {
+    uint32_t ret;
+    __asm__ volatile ("int $0x80"
+                      : "=a"(ret)
+                      : "a"(n), "b"(a), "c"(b), "d"(c), "S"(d), "D"(e)
+                      : "memory");
+    return ret;
+}
+
+// Whether the kernel enabled SYSENTER (no SEP, or a part with the Pentium
+// Pro erratum, means int 0x80 only). Read from the time page every process has.
+static inline int syscall_fast(void) {
+    return (((const struct vtime_page*)VTIME_VA)->features & VTIME_F_SYSENTER) != 0;
+}
+
+// Fast path: SYSENTER. The kernel returns with SYSEXIT, which takes the
+// user eip/esp from edx/ecx, so we leave the return address on the stack
+// with ebp pointing at it and let the kernel hand it back; ecx/edx come
+// back clobbered.
+static inline uint32_t syscall3(uint32_t n, uint32_t a, uint32_t b, uint32_t c) {
+    if (!syscall_fast()) return syscall3_int80(n, a, b, c);
+    uint32_t ret;
+    __asm__ volatile ("pushl %%ebp\n\t"
+                      "pushl $1f\n\t"
+                      "movl %%esp, %%ebp\n\t"
+                      "sysenter\n"
+                      "1:\n\t"
+                      "popl %%ebp"
+                      : "=a"(ret), "+c"(b), "+d"(c)
+                      : "a"(n), "b"(a)
+                      : "memory");
+    return ret;
+}
+
+// Same, two more args in esi/edi.
+static inline uint32_t syscall5(uint32_t n, uint32_t a, uint32_t b, uint32_t c,
+                                uint32_t d, uint32_t e) {
+    if (!syscall_fast()) return syscall5_int80(n, a, b, c, d, e);
+    uint32_t ret;
+    __asm__ volatile ("pushl %%ebp\n\t"
+                      "pushl $1f\n\t"
+                      "movl %%esp, %%ebp\n\t"
+                      "sysenter\n"
+                      "1:\n\t"
+                      "popl %%ebp"
+                      : "=a"(ret), "+c"(b), "+d"(c)
+                      : "a"(n), "b"(a), "S"(d), "D"(e)
+                      : "memory");
+    return ret;
+}
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef _SYS_SYSCALL_LIST_H
+#define _SYS_SYSCALL_LIST_H 1
+
+// The one list of system calls: X(number, name). <sys/syscall.h> turns it
+// into SYS_* numbers, the kernel into its dispatch table (sys_<name>).
+#define SYSCALL_LIST(X) \
+    X(1, putchar)       \
+    X(2, exit)          \
+    X(3, read)          \
+    X(4, write)         \
+    X(5, open)          \
+    X(6, close)         \
+    X(17, pread)        \
+    X(19, lseek)        \
+    X(28, fstat)        \
+    X(40, uring_setup)  \
+    X(41, uring_enter)  \
+    X(45, brk)          \
+    X(90, mmap)         \
+    X(91, munmap)
+
+// table size; numbers must stay below this
+#define SYSCALL_MAX 128
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef _SYS_URING_H
+#define _SYS_URING_H 1
+
+#include <stdint.h>
+
+// Submission/completion rings shared between one process and the kernel.
+// One page at URING_VA: header, URING_SQ_ENTRIES SQEs, URING_CQ_ENTRIES CQEs.
+// The user owns sq_tail and cq_head, the kernel sq_head and cq_tail; all four
+// run freely and are masked on use.
+
+#define URING_VA          0x01800000u
+#define URING_SQ_ENTRIES  64u
+#define URING_CQ_ENTRIES  128u
+
+// uring_setup() flags
+#define URING_F_POLL      0x1u   // kernel also drains the SQ on timer ticks
+
+#define URING_OP_NOP      0
+#define URING_OP_WRITE    1      // fd, addr=buf, len
+#define URING_OP_READ     2      // fd, addr=buf, len, off (URING_OFF_CUR = file position)
+#define URING_OP_OPEN     3      // addr=path
+#define URING_OP_CLOSE    4      // fd
+
+#define URING_OFF_CUR     0xFFFFFFFFu
+
+struct uring_sqe {
+    uint8_t  op;
+    uint8_t  pad[3];
+    int32_t  fd;
+    uint32_t addr;
+    uint32_t len;
+    uint32_t off;
+    uint32_t user_data;
+};
+
+struct uring_cqe {
+    uint32_t user_data;
+    int32_t  res;        // syscall-style result, -1 on error
+};
+
+struct uring {
+    volatile uint32_t sq_head, sq_tail;
+    volatile uint32_t cq_head, cq_tail;
+    volatile uint32_t flags;
+    volatile uint32_t cq_overflow;   // completions dropped on a full CQ
+    uint32_t pad[10];
+    struct uring_sqe sq[URING_SQ_ENTRIES];
+    struct uring_cqe cq[URING_CQ_ENTRIES];
+};
+
+#if !defined(__is_kernel) && !defined(__is_libk)
+#include <sys/syscall.h>
+
+static inline struct uring* uring_setup(uint32_t flags) {
+    int32_t r = (int32_t)syscall3(SYS_uring_setup, flags, 0, 0);
+    return r < 0 ? 0 : (struct uring*)r;
+}
+
+// Submit up to 'n' queued SQEs; returns how many the kernel consumed.
+static inline int uring_enter(uint32_t n) {
+    return (int)syscall3(SYS_uring_enter, n, 0, 0);
+}
+
+// Next free SQE, or 0 when the SQ is full.
+static inline struct uring_sqe* uring_get_sqe(struct uring* u) {
+    if (u->sq_tail - u->sq_head >= URING_SQ_ENTRIES) return 0;
+    return &u->sq[u->sq_tail & (URING_SQ_ENTRIES - 1)];
+}
+
+// Publish the SQE returned by uring_get_sqe().
+static inline void uring_queue(struct uring* u) {
+    __asm__ volatile ("" ::: "memory");
+    u->sq_tail++;
+}
+
+// Next completion, or 0; release it with uring_cqe_seen().
+static inline struct uring_cqe* uring_peek_cqe(struct uring* u) {
+    if (u->cq_head == u->cq_tail) return 0;
+    __asm__ volatile ("" ::: "memory");
+    return &u->cq[u->cq_head & (URING_CQ_ENTRIES - 1)];
+}
+
+static inline void uring_cqe_seen(struct uring* u) {
+    __asm__ volatile ("" ::: "memory");
+    u->cq_head++;
+}
+#endif
+
+#endif
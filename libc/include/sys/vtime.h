@@ -0,0 +1,21 @@
+#ifndef _SYS_VTIME_H
+#define _SYS_VTIME_H 1
+
+#include <stdint.h>
+
+// Read-only page the kernel maps into every process at VTIME_VA and updates
+// from the timer IRQ. Readers retry while seq is odd or changed under them.
+#define VTIME_VA 0x01700000u
+
+struct vtime_page {
+    volatile uint32_t seq;
+    volatile uint32_t hz;            // timer ticks per second
+    volatile uint64_t ticks;
+    volatile uint64_t tsc_at_tick;   // TSC when 'ticks' last advanced
+    volatile uint64_t tsc_per_tick;  // calibrated against the PIT, 0 = no TSC / not yet
+    volatile uint32_t features;      // VTIME_F_*, set once at boot
+};
+
+#define VTIME_F_SYSENTER 0x1u        // sysenter/sysexit syscalls work on this machine
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef _TIME_H
+#define _TIME_H 1
+
+#include <sys/cdefs.h>
+#include <stdint.h>
+
+typedef int clockid_t;
+typedef int32_t time_t;
+
+// no RTC yet: both count from boot
+#define CLOCK_REALTIME  0
+#define CLOCK_MONOTONIC 1
+
+struct timespec {
+	time_t tv_sec;
+	long   tv_nsec;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int clock_gettime(clockid_t clk, struct timespec* ts);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef _UNISTD_H
+#define _UNISTD_H 1
+
+#include <sys/cdefs.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define STDIN_FILENO  0
+#define STDOUT_FILENO 1
+#define STDERR_FILENO 2
+
+#define SEEK_SET 0
+#define SEEK_CUR 1
+#define SEEK_END 2
+
+typedef int32_t off_t;
+typedef int32_t ssize_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int write(int fd, const void* buf, size_t len);
+ssize_t read(int fd, void* buf, size_t len);
+ssize_t pread(int fd, void* buf, size_t len, off_t off);
+off_t lseek(int fd, off_t off, int whence);
+int close(int fd);
+
+__attribute__((__noreturn__))
+void _exit(int status);
+
+int   brk(void* addr);
+void* sbrk(intptr_t incr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
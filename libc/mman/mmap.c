@@ -0,0 +1,12 @@
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+void* mmap(void* addr, size_t len, int prot, int flags, int fd, uint32_t off) {
+	struct mmap_args a = { (uint32_t)addr, (uint32_t)len, (uint32_t)prot, (uint32_t)flags, fd, off };
+	uint32_t r = syscall3(SYS_mmap, (uint32_t)&a, 0, 0);
+	return r == (uint32_t)-1 ? MAP_FAILED : (void*)r;
+}
+
+int munmap(void* addr, size_t len) {
+	return (int)syscall3(SYS_munmap, (uint32_t)addr, (uint32_t)len, 0);
+}
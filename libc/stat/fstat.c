@@ -0,0 +1,6 @@
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+int fstat(int fd, struct stat* st) {
+	return (int)syscall3(SYS_fstat, (uint32_t)fd, (uint32_t)st, 0);
+}
@@ -0,0 +1,22 @@
+#include <stdio.h>
+#include <unistd.h>
+
+// stdout: line buffered, drained with one write() per flush
+static struct __FILE __stdout_file;
+FILE* stdout = &__stdout_file;
+
+int fflush(FILE* stream) {
+	if (!stream) stream = stdout;
+
+	size_t off = 0;
+	while (off < stream->len) {
+		int r = write(STDOUT_FILENO, stream->buf + off, stream->len - off);
+		if (r <= 0) {
+			stream->len = 0;
+			return EOF;
+		}
+		off += (size_t)r;
+	}
+	stream->len = 0;
+	return 0;
+}
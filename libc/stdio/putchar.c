@@ -9,7 +9,11 @@ int putchar(int ic) {
 	char c = (char) ic;
 	terminal_write(&c, sizeof(c));
 #else
-	// TODO: Implement stdio and the write system call.
+	// buffer, one write() per line (or per full buffer) instead of per byte
+	stdout->buf[stdout->len++] = (char) ic;
+	if ((char) ic == '\n' || stdout->len == sizeof(stdout->buf)) {
+		if (fflush(stdout) == EOF) return EOF;
+	}
 #endif
 	return ic;
 }
\ No newline at end of file
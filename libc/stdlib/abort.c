@@ -1,5 +1,8 @@
 #include <stdio.h>
 #include <stdlib.h>
+#if !defined(__is_libk)
+#include <unistd.h>
+#endif
 
 __attribute__((__noreturn__))
 void abort(void) {
@@ -8,8 +11,10 @@ void abort(void) {
 	printf("kernel: panic: abort()\n");
         asm volatile("hlt");
 #else
-	// TODO: Abnormally terminate the process as if by SIGABRT.
+	// No signals yet: report and terminate without running exit().
 	printf("abort()\n");
+	fflush(stdout);
+	_exit(134);
 #endif
 	while (1) { }
 	__builtin_unreachable();
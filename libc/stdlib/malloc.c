@@ -0,0 +1,129 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+// Small blocks: power-of-two size classes (header included) with a free
+// list each, carved from a brk arena on demand. Big blocks get their own
+// anonymous mapping and go straight back to the kernel on free.
+//
+// Every block starts with a 16-byte header, so payloads stay 16-aligned.
+
+#define HDR          16u
+#define MIN_SHIFT    5u                      // 32-byte blocks
+#define NUM_CLASSES  8u                      // ... up to 4096
+#define MAX_SMALL    (1u << (MIN_SHIFT + NUM_CLASSES - 1))
+#define ARENA_GROW   (64u * 1024u)
+#define BIG_MAGIC    0xB16B10C5u
+#define SMALL_MAGIC  0x5A11B10Cu
+
+typedef struct hdr {
+	uint32_t magic;
+	uint32_t size;          // small: class index; big: mapping length
+	uint32_t pad[2];
+} hdr_t;
+
+typedef struct free_blk {
+	struct free_blk* next;
+} free_blk_t;
+
+static free_blk_t* g_free[NUM_CLASSES];
+static uint8_t* g_arena;        // bump pointer into brk memory
+static uint8_t* g_arena_end;
+
+static uint32_t class_of(size_t total) {
+	uint32_t c = 0;
+	while ((1u << (MIN_SHIFT + c)) < total) c++;
+	return c;
+}
+
+static void* arena_take(uint32_t bytes) {
+	if ((uint32_t)(g_arena_end - g_arena) < bytes) {
+		// first call, or the old tail is too short: start a fresh chunk
+		uint8_t* p = (uint8_t*) sbrk(ARENA_GROW);
+		if (p == (uint8_t*) -1) return 0;
+		if (p != g_arena_end || !g_arena) {
+			g_arena = (uint8_t*) (((uintptr_t) p + HDR - 1) & ~(uintptr_t)(HDR - 1));
+		}
+		g_arena_end = p + ARENA_GROW;
+		if ((uint32_t)(g_arena_end - g_arena) < bytes) return 0;
+	}
+	void* b = g_arena;
+	g_arena += bytes;
+	return b;
+}
+
+void* malloc(size_t size) {
+	if (size == 0) size = 1;
+	if (size > 0xFFFFFFFFu - HDR - 0xFFFu) return 0;
+
+	size_t total = size + HDR;
+	hdr_t* h;
+
+	if (total <= MAX_SMALL) {
+		uint32_t c = class_of(total);
+		if (g_free[c]) {
+			h = (hdr_t*) g_free[c];
+			g_free[c] = g_free[c]->next;
+		} else {
+			h = (hdr_t*) arena_take(1u << (MIN_SHIFT + c));
+			if (!h) return 0;
+		}
+		h->magic = SMALL_MAGIC;
+		h->size = c;
+	} else {
+		size_t len = (total + 0xFFFu) & ~(size_t)0xFFFu;
+		h = (hdr_t*) mmap(0, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (h == MAP_FAILED) return 0;
+		h->magic = BIG_MAGIC;
+		h->size = (uint32_t) len;
+	}
+	return (uint8_t*) h + HDR;
+}
+
+static size_t usable(const hdr_t* h) {
+	if (h->magic == SMALL_MAGIC) return (1u << (MIN_SHIFT + h->size)) - HDR;
+	return h->size - HDR;
+}
+
+void free(void* ptr) {
+	if (!ptr) return;
+
+	hdr_t* h = (hdr_t*) ((uint8_t*) ptr - HDR);
+	if (h->magic == SMALL_MAGIC) {
+		uint32_t c = h->size;
+		h->magic = 0;
+		free_blk_t* b = (free_blk_t*) h;
+		b->next = g_free[c];
+		g_free[c] = b;
+	} else if (h->magic == BIG_MAGIC) {
+		h->magic = 0;
+		munmap(h, h->size);
+	} else {
+		abort();   // double free or not ours
+	}
+}
+
+void* calloc(size_t n, size_t size) {
+	if (size && n > 0xFFFFFFFFu / size) return 0;
+	size_t total = n * size;
+	void* p = malloc(total);
+	if (p) memset(p, 0, total);
+	return p;
+}
+
+void* realloc(void* ptr, size_t size) {
+	if (!ptr) return malloc(size);
+	if (size == 0) { free(ptr); return 0; }
+
+	hdr_t* h = (hdr_t*) ((uint8_t*) ptr - HDR);
+	size_t have = usable(h);
+	if (size <= have) return ptr;
+
+	void* n = malloc(size);
+	if (!n) return 0;
+	memcpy(n, ptr, have);
+	free(ptr);
+	return n;
+}
@@ -1,13 +1,24 @@
 #include <string.h>
+#include <stdint.h>
 
 int memcmp(const void* aptr, const void* bptr, size_t size) {
 	const unsigned char* a = (const unsigned char*) aptr;
 	const unsigned char* b = (const unsigned char*) bptr;
-	for (size_t i = 0; i < size; i++) {
+
+	// skip equal words, then find the differing byte
+	size_t i = 0;
+	for (; i + 4 <= size; i += 4) {
+		uint32_t x, y;
+		__builtin_memcpy(&x, a + i, 4);
+		__builtin_memcpy(&y, b + i, 4);
+		if (x != y)
+			break;
+	}
+	for (; i < size; i++) {
 		if (a[i] < b[i])
 			return -1;
 		else if (b[i] < a[i])
 			return 1;
 	}
 	return 0;
-}
\ No newline at end of file
+}
@@ -1,9 +1,20 @@
 #include <string.h>
+#include <stdint.h>
 
 void* memcpy(void* restrict dstptr, const void* restrict srcptr, size_t size) {
+#if defined(__i386__)
+	// dwords with rep movsl, then the 0-3 byte tail
+	void* d = dstptr;
+	const void* s = srcptr;
+	size_t n = size >> 2;
+	__asm__ volatile ("rep movsl" : "+D"(d), "+S"(s), "+c"(n) : : "memory");
+	n = size & 3;
+	__asm__ volatile ("rep movsb" : "+D"(d), "+S"(s), "+c"(n) : : "memory");
+#else
 	unsigned char* dst = (unsigned char*) dstptr;
 	const unsigned char* src = (const unsigned char*) srcptr;
 	for (size_t i = 0; i < size; i++)
 		dst[i] = src[i];
+#endif
 	return dstptr;
-}
\ No newline at end of file
+}
@@ -3,12 +3,18 @@
 void* memmove(void* dstptr, const void* srcptr, size_t size) {
 	unsigned char* dst = (unsigned char*) dstptr;
 	const unsigned char* src = (const unsigned char*) srcptr;
-	if (dst < src) {
-		for (size_t i = 0; i < size; i++)
-			dst[i] = src[i];
-	} else {
-		for (size_t i = size; i != 0; i--)
-			dst[i-1] = src[i-1];
-	}
+	// forward copy is safe unless dst starts inside src
+	if (dst <= src || dst >= src + size)
+		return memcpy(dstptr, srcptr, size);
+#if defined(__i386__)
+	// overlapping, copy backwards with DF set
+	void* d = dst + size - 1;
+	const void* s = src + size - 1;
+	size_t n = size;
+	__asm__ volatile ("std\n\trep movsb\n\tcld" : "+D"(d), "+S"(s), "+c"(n) : : "memory");
+#else
+	for (size_t i = size; i != 0; i--)
+		dst[i-1] = src[i-1];
+#endif
 	return dstptr;
-}
\ No newline at end of file
+}
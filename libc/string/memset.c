@@ -1,8 +1,21 @@
 #include <string.h>
+#include <stdint.h>
 
 void* memset(void* bufptr, int value, size_t size) {
+#if defined(__i386__)
+	// byte splatted into a dword, rep stosl, then the tail
+	uint32_t v = (uint8_t) value;
+	v |= v << 8;
+	v |= v << 16;
+	void* d = bufptr;
+	size_t n = size >> 2;
+	__asm__ volatile ("rep stosl" : "+D"(d), "+c"(n) : "a"(v) : "memory");
+	n = size & 3;
+	__asm__ volatile ("rep stosb" : "+D"(d), "+c"(n) : "a"(v) : "memory");
+#else
 	unsigned char* buf = (unsigned char*) bufptr;
 	for (size_t i = 0; i < size; i++)
 		buf[i] = (unsigned char) value;
+#endif
 	return bufptr;
-}
\ No newline at end of file
+}
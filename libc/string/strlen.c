@@ -1,8 +1,30 @@
 #include <string.h>
+#include <stdint.h>
+
+// word loads over char data: may_alias keeps -O2's strict aliasing honest
+typedef uint32_t __attribute__((__may_alias__)) word_t;
 
 size_t strlen(const char* str) {
-	size_t len = 0;
-	while (str[len])
-		len++;
-	return len;
-}
\ No newline at end of file
+	const char* s = str;
+
+	// bytes until aligned, then a word at a time
+	while ((uintptr_t) s & 3) {
+		if (!*s)
+			return (size_t)(s - str);
+		s++;
+	}
+
+	// aligned loads never cross into an unmapped page
+	const word_t* w = (const word_t*) s;
+	for (;;) {
+		uint32_t v = *w;
+		if ((v - 0x01010101u) & ~v & 0x80808080u)
+			break;
+		w++;
+	}
+
+	s = (const char*) w;
+	while (*s)
+		s++;
+	return (size_t)(s - str);
+}
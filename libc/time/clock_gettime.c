@@ -0,0 +1,42 @@
+#include <time.h>
+#include <sys/vtime.h>
+
+static inline uint64_t rdtsc(void) {
+	uint32_t lo, hi;
+	__asm__ volatile ("rdtsc" : "=a"(lo), "=d"(hi));
+	return ((uint64_t)hi << 32) | lo;
+}
+
+// Lockless read of the kernel's time page: no system call.
+int clock_gettime(clockid_t clk, struct timespec* ts) {
+	if (clk != CLOCK_REALTIME && clk != CLOCK_MONOTONIC) return -1;
+
+	const struct vtime_page* vt = (const struct vtime_page*)VTIME_VA;
+	uint32_t seq, hz;
+	uint64_t ticks, tsc_at, tsc_per, now;
+	do {
+		seq = vt->seq;
+		__asm__ volatile ("" ::: "memory");
+		hz = vt->hz;
+		ticks = vt->ticks;
+		tsc_at = vt->tsc_at_tick;
+		tsc_per = vt->tsc_per_tick;
+		now = tsc_per ? rdtsc() : 0;
+		__asm__ volatile ("" ::: "memory");
+	} while ((seq & 1) || seq != vt->seq);
+
+	if (!hz) return -1;
+
+	uint64_t ns_per_tick = 1000000000ull / hz;
+	uint64_t ns = ticks * ns_per_tick;
+	if (tsc_per) {
+		// interpolate inside the current tick
+		uint64_t d = now - tsc_at;
+		if (d > tsc_per) d = tsc_per;
+		ns += d * ns_per_tick / tsc_per;
+	}
+
+	ts->tv_sec = (time_t)(ns / 1000000000ull);
+	ts->tv_nsec = (long)(ns % 1000000000ull);
+	return 0;
+}
@@ -0,0 +1,20 @@
+#include <unistd.h>
+#include <sys/syscall.h>
+
+static uint32_t __brk_cur = 0;
+
+int brk(void* addr) {
+	uint32_t r = syscall3(SYS_brk, (uint32_t)addr, 0, 0);
+	__brk_cur = r;
+	return r == (uint32_t)addr ? 0 : -1;
+}
+
+void* sbrk(intptr_t incr) {
+	if (!__brk_cur) __brk_cur = syscall3(SYS_brk, 0, 0, 0);
+	uint32_t old = __brk_cur;
+	if (incr == 0) return (void*)old;
+
+	uint32_t want = old + (uint32_t)incr;
+	if (brk((void*)want) < 0) return (void*)-1;
+	return (void*)old;
+}
@@ -0,0 +1,6 @@
+#include <unistd.h>
+#include <sys/syscall.h>
+
+int close(int fd) {
+	return (int)syscall3(SYS_close, (uint32_t)fd, 0, 0);
+}
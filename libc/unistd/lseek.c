@@ -0,0 +1,6 @@
+#include <unistd.h>
+#include <sys/syscall.h>
+
+off_t lseek(int fd, off_t off, int whence) {
+	return (off_t)syscall3(SYS_lseek, (uint32_t)fd, (uint32_t)off, (uint32_t)whence);
+}
@@ -0,0 +1,6 @@
+#include <unistd.h>
+#include <sys/syscall.h>
+
+ssize_t pread(int fd, void* buf, size_t len, off_t off) {
+	return (ssize_t)syscall5(SYS_pread, (uint32_t)fd, (uint32_t)buf, (uint32_t)len, (uint32_t)off, 0);
+}
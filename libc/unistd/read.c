@@ -0,0 +1,6 @@
+#include <unistd.h>
+#include <sys/syscall.h>
+
+ssize_t read(int fd, void* buf, size_t len) {
+	return (ssize_t)syscall3(SYS_read, (uint32_t)fd, (uint32_t)buf, (uint32_t)len);
+}
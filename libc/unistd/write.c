@@ -0,0 +1,6 @@
+#include <unistd.h>
+#include <sys/syscall.h>
+
+int write(int fd, const void* buf, size_t len) {
+	return (int)syscall3(SYS_write, (uint32_t)fd, (uint32_t)buf, (uint32_t)len);
+}
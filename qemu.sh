@@ -2,4 +2,4 @@
 set -e
 . ./iso.sh
 
-qemu-system-$(./target-triplet-to-arch.sh $HOST) -cdrom bobliu.iso -no-reboot -no-shutdown -d int,cpu_reset -D qemu.log
\ No newline at end of file
+qemu-system-$(./target-triplet-to-arch.sh $HOST) -cdrom bobliu.iso -smp "${SMP:-4}" -no-reboot -no-shutdown -d int,cpu_reset -D qemu.log
\ No newline at end of file